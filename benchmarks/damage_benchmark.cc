@@ -0,0 +1,103 @@
+// Compares accumulating output damage in a pixman Region with the tile grid
+// of TileDamage, for damage made of many small rectangles as terminals and
+// spreadsheets send it.
+//
+// Usage: damage_benchmark [rects per frame] [frames]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "base/geometry.h"
+#include "compositor/region.h"
+#include "compositor/tile_damage.h"
+
+namespace {
+
+using naive::base::geometry::Rect;
+
+constexpr int32_t kWidth = 3840;
+constexpr int32_t kHeight = 2160;
+// Age of the back buffer, in frames, damage is accumulated over.
+constexpr int32_t kBufferAge = 3;
+
+using Frames = std::vector<std::vector<Rect>>;
+
+// Damage of text cells of 8x16 pixels scattered over the output.
+Frames MakeFrames(int32_t rects_per_frame, int32_t frames) {
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int32_t> column(0, kWidth / 8 - 1);
+  std::uniform_int_distribution<int32_t> row(0, kHeight / 16 - 1);
+  std::uniform_int_distribution<int32_t> length(1, 8);
+  Frames result(frames);
+  for (auto& frame : result) {
+    for (int32_t i = 0; i < rects_per_frame; i++)
+      frame.push_back(Rect(column(random) * 8, row(random) * 16,
+                           length(random) * 8, 16));
+  }
+  return result;
+}
+
+template <typename Function>
+double TimeUs(Function function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Returns how many rectangles the accumulated damage of each frame had, to
+// keep the work from being optimized away.
+size_t RunRegion(const Frames& frames) {
+  size_t total = 0;
+  std::vector<naive::Region> history;
+  for (auto& frame : frames) {
+    naive::Region damage = naive::Region::Empty();
+    for (auto& rect : frame)
+      damage.Union(rect);
+    history.push_back(damage);
+    if (history.size() > kBufferAge)
+      history.erase(history.begin());
+    naive::Region accumulated = naive::Region::Empty();
+    for (auto& region : history)
+      accumulated.Union(region);
+    total += accumulated.rectangles().size();
+  }
+  return total;
+}
+
+size_t RunTiles(const Frames& frames) {
+  size_t total = 0;
+  naive::compositor::TileDamage damage(kWidth, kHeight);
+  for (auto& frame : frames) {
+    for (auto& rect : frame)
+      damage.Add(rect);
+    total += damage.ToRects(damage.Accumulate(kBufferAge)).size();
+    damage.NextFrame();
+  }
+  return total;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int32_t rects_per_frame = argc > 1 ? atoi(argv[1]) : 2000;
+  int32_t frame_count = argc > 2 ? atoi(argv[2]) : 500;
+  Frames frames = MakeFrames(rects_per_frame, frame_count);
+
+  size_t region_rects = 0, tile_rects = 0;
+  double region_us = TimeUs([&]() { region_rects = RunRegion(frames); });
+  double tiles_us = TimeUs([&]() { tile_rects = RunTiles(frames); });
+
+  printf("%d frames of %d rects, buffer age %d\n", frame_count,
+         rects_per_frame, kBufferAge);
+  printf("Region:     %10.1f us/frame, %8.1f rects/frame\n",
+         region_us / frame_count,
+         static_cast<double>(region_rects) / frame_count);
+  printf("TileDamage: %10.1f us/frame, %8.1f rects/frame\n",
+         tiles_us / frame_count,
+         static_cast<double>(tile_rects) / frame_count);
+  return 0;
+}
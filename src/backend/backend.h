@@ -21,6 +21,8 @@ class Backend {
   virtual void* PointerData() { return nullptr; }
   virtual void MoveCursor(int32_t x, int32_t y) {}
   virtual void FinalizeDraw(bool did_draw) = 0;
+  // Whether the last submitted frame is still waiting to reach the screen.
+  virtual bool FlipPending() { return false; }
   virtual EglContext* egl() = 0;
   virtual wayland::DisplayMetrics* display_metrics() = 0;
   virtual event::EventHub* GetEventHub() = 0;
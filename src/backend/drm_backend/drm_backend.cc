@@ -1,5 +1,6 @@
 #include "backend/drm_backend/drm_backend.h"
 
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -165,6 +166,10 @@ drm_fb* drm_fb_get_from_bo(gbm_bo* bo) {
   return fb;
 }
 
+gbm_bo* bo = nullptr;
+// Buffer queued for the next flip, released into |bo| when the flip is done.
+gbm_bo* pending_bo = nullptr;
+
 void page_flip_handler(int fd,
                        unsigned int frame,
                        unsigned int sec,
@@ -172,6 +177,11 @@ void page_flip_handler(int fd,
                        void* data) {
   int* waiting_for_flip = static_cast<int*>(data);
   *waiting_for_flip = 0;
+  if (pending_bo) {
+    gbm_surface_release_buffer(gbm.surface, bo);
+    bo = pending_bo;
+    pending_bo = nullptr;
+  }
 }
 
 drmEventContext evctx{
@@ -179,7 +189,6 @@ drmEventContext evctx{
 };
 
 fd_set fds;
-gbm_bo* bo = nullptr;
 drm_fb* fb;
 
 void* initialize_cursor() {
@@ -221,20 +230,45 @@ void move_cursor(int32_t x, int32_t y) {
 }
 
 void wait_page_flip() {
-  if (fb) {
-    waiting_for_flip = 1;
-    drmModePageFlip(drm.fd, drm.crtc_id, fb->fb_id, DRM_MODE_PAGE_FLIP_EVENT,
-                    &waiting_for_flip);
-    while (waiting_for_flip) {
-      select(drm.fd + 1, &fds, nullptr, nullptr, nullptr);
-      drmHandleEvent(drm.fd, &evctx);
-    }
+  while (waiting_for_flip) {
+    select(drm.fd + 1, &fds, nullptr, nullptr, nullptr);
+    drmHandleEvent(drm.fd, &evctx);
+  }
+}
+
+// Queues a flip to |fb| without waiting for it. The flip event is handled
+// from the looper, so the next frame can be built in the meantime.
+void queue_page_flip(gbm_bo* next_bo) {
+  if (!fb)
+    return;
+  // Only one flip can be in flight.
+  wait_page_flip();
+  waiting_for_flip = 1;
+  pending_bo = next_bo;
+  if (drmModePageFlip(drm.fd, drm.crtc_id, fb->fb_id,
+                      DRM_MODE_PAGE_FLIP_EVENT, &waiting_for_flip)) {
+    LOG_ERROR << "page flip failed " << strerror(errno);
+    // |bo| is still scanned out, and the frame in |next_bo| is dropped.
+    gbm_surface_release_buffer(gbm.surface, next_bo);
+    pending_bo = nullptr;
+    waiting_for_flip = 0;
   }
 }
 
+void handle_drm_events() {
+  // The looper runs every handler on each iteration, and drmHandleEvent
+  // blocks on read, so check for an event first.
+  pollfd pfd = {.fd = drm.fd, .events = POLLIN};
+  if (poll(&pfd, 1, 0) > 0)
+    drmHandleEvent(drm.fd, &evctx);
+}
+
 void finalize_draw(bool did_draw, EglContext* context) {
   if (did_draw) {
     gbm_bo* next_bo = nullptr;
+    // A new frame is only submitted once the last flip is done, swapping
+    // earlier could run out of buffers in the gbm surface.
+    wait_page_flip();
     context->SwapBuffers();
     next_bo = gbm_surface_lock_front_buffer(gbm.surface);
     fb = drm_fb_get_from_bo(next_bo);
@@ -242,13 +276,11 @@ void finalize_draw(bool did_draw, EglContext* context) {
       drmModeSetCrtc(drm.fd, drm.crtc_id, fb->fb_id, 0, 0, &drm.connector_id, 1,
                      drm.mode);
       fb->need_modset = false;
+      gbm_surface_release_buffer(gbm.surface, bo);
+      bo = next_bo;
     } else {
-      wait_page_flip();
+      queue_page_flip(next_bo);
     }
-    gbm_surface_release_buffer(gbm.surface, bo);
-    bo = next_bo;
-  } else {
-    wait_page_flip();
   }
 }
 
@@ -282,6 +314,10 @@ void DrmBackend::FinalizeDraw(bool did_draw) {
   finalize_draw(did_draw, egl_.get());
 }
 
+bool DrmBackend::FlipPending() {
+  return waiting_for_flip != 0;
+}
+
 void DrmBackend::MoveCursor(int32_t x, int32_t y) {
   move_cursor(x, y);
 }
@@ -289,6 +325,7 @@ void DrmBackend::MoveCursor(int32_t x, int32_t y) {
 void DrmBackend::AddHandler(base::Looper* handler) {
   handler->AddFd(event_hub_->GetFileDescriptor(),
                  [this]() { this->event_hub_->HandleEvents(); });
+  handler->AddFd(drm.fd, handle_drm_events);
 }
 
 }  // namespace backend
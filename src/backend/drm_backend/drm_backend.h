@@ -28,6 +28,7 @@ class DrmBackend : public Backend {
   void* PointerData() override { return cursor_data_; }
   void MoveCursor(int32_t x, int32_t y) override;
   void FinalizeDraw(bool did_draw) override;
+  bool FlipPending() override;
   EglContext* egl() override { return egl_.get(); }
   wayland::DisplayMetrics* display_metrics() override {
     return display_metrics_.get();
@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 
 #include "base/logging.h"
 
@@ -59,6 +60,9 @@ EglContext::EglContext(void* native_display,
   assert(gl.surface);
   eglMakeCurrent(gl.display, gl.surface, gl.surface, gl.context);
   eglSwapInterval(gl.display, 1);
+  const char* extensions = eglQueryString(gl.display, EGL_EXTENSIONS);
+  has_buffer_age_ =
+      extensions && strstr(extensions, "EGL_EXT_buffer_age") != nullptr;
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
@@ -76,6 +80,13 @@ void EglContext::CreateDrawBuffer(int32_t width, int32_t height) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                          rendered_texture_, 0);
+  glGenRenderbuffers(1, &depth_buffer_);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer_);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, display_width_,
+                        display_height_);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_buffer_);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
   assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
@@ -84,12 +95,31 @@ void EglContext::BindDrawBuffer(bool bind) {
   glBindFramebuffer(GL_FRAMEBUFFER, bind ? framebuffer_ : 0);
 }
 
-void EglContext::BlitFrameBuffer() {
+void EglContext::BlitFrameBuffer(
+    const std::vector<base::geometry::Rect>& rects) {
   glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
   glReadBuffer(GL_COLOR_ATTACHMENT0);
   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-  glBlitFramebuffer(0, 0, display_width_, display_height_, 0, 0, display_width_,
-                    display_height_, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  // The blit is scissored to each rectangle, flipped to GL's bottom-left
+  // origin.
+  glEnable(GL_SCISSOR_TEST);
+  for (auto& rect : rects) {
+    glScissor(rect.x(), display_height_ - rect.y() - rect.height(),
+              rect.width(), rect.height());
+    glBlitFramebuffer(0, 0, display_width_, display_height_, 0, 0,
+                      display_width_, display_height_, GL_COLOR_BUFFER_BIT,
+                      GL_LINEAR);
+  }
+  glDisable(GL_SCISSOR_TEST);
+}
+
+int32_t EglContext::BufferAge() {
+  if (!has_buffer_age_)
+    return 0;
+  EGLint age = 0;
+  if (!eglQuerySurface(gl.display, gl.surface, EGL_BUFFER_AGE_EXT, &age))
+    return 0;
+  return age;
 }
 
 void EglContext::MakeCurrent() {
@@ -6,6 +6,9 @@
 #include <GLES3/gl3.h>
 #include <GLES3/gl3ext.h>
 #include <cstdint>
+#include <vector>
+
+#include "base/geometry.h"
 
 namespace naive {
 namespace backend {
@@ -16,7 +19,11 @@ class EglContext {
   ~EglContext() = default;
   void CreateDrawBuffer(int32_t width, int32_t height);
   void BindDrawBuffer(bool bind);
-  void BlitFrameBuffer();
+  // Copies |rects| of the draw buffer, in top-left based pixels, to the
+  // back buffer.
+  void BlitFrameBuffer(const std::vector<base::geometry::Rect>& rects);
+  // How many frames ago the back buffer was last drawn, 0 if unknown.
+  int32_t BufferAge();
   void MakeCurrent();
   void SwapBuffers();
   void EnableBlend(bool enable);
@@ -26,6 +33,10 @@ class EglContext {
   int32_t display_width_, display_height_;
   GLuint framebuffer_;
   GLuint rendered_texture_;
+  // Lets the compositor reject hidden fragments with depth testing.
+  GLuint depth_buffer_;
+  // Whether EGL_EXT_buffer_age tells what the back buffer holds.
+  bool has_buffer_age_ = false;
 };
 
 }  // namespace backend
@@ -0,0 +1,83 @@
+#include "base/hash.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define HAS_X86_CRC32C
+#endif
+
+namespace naive {
+namespace base {
+
+namespace {
+
+// Reflected CRC32C polynomial.
+constexpr uint32_t kCrc32cPolynomial = 0x82F63B78;
+
+struct Crc32cTable {
+  Crc32cTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; j++)
+        crc = (crc >> 1) ^ (kCrc32cPolynomial & (0 - (crc & 1)));
+      entries[i] = crc;
+    }
+  }
+  uint32_t entries[256];
+};
+
+uint32_t Crc32cSoftware(uint32_t crc, const uint8_t* data, size_t length) {
+  static const Crc32cTable table;
+  for (size_t i = 0; i < length; i++)
+    crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+#ifdef HAS_X86_CRC32C
+__attribute__((target("sse4.2"))) uint32_t Crc32cHardware(uint32_t crc,
+                                                          const uint8_t* data,
+                                                          size_t length) {
+#if defined(__x86_64__)
+  uint64_t crc64 = crc;
+  while (length >= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += sizeof(uint64_t);
+    length -= sizeof(uint64_t);
+  }
+  crc = static_cast<uint32_t>(crc64);
+#endif
+  while (length >= sizeof(uint32_t)) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = _mm_crc32_u32(crc, word);
+    data += sizeof(uint32_t);
+    length -= sizeof(uint32_t);
+  }
+  while (length--)
+    crc = _mm_crc32_u8(crc, *data++);
+  return crc;
+}
+
+bool HasHardwareCrc32c() {
+  static const bool supported = __builtin_cpu_supports("sse4.2");
+  return supported;
+}
+#endif
+
+}  // namespace
+
+uint32_t Crc32c(uint32_t crc, const void* data, size_t length) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+#ifdef HAS_X86_CRC32C
+  if (HasHardwareCrc32c())
+    return ~Crc32cHardware(crc, bytes, length);
+#endif
+  return ~Crc32cSoftware(crc, bytes, length);
+}
+
+}  // namespace base
+}  // namespace naive
@@ -0,0 +1,17 @@
+#ifndef BASE_HASH_H_
+#define BASE_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace naive {
+namespace base {
+
+// Computes CRC32C (Castagnoli) of |length| bytes at |data|, continuing from
+// |crc|. Uses the SSE4.2 crc32 instruction when the CPU supports it.
+uint32_t Crc32c(uint32_t crc, const void* data, size_t length);
+
+}  // namespace base
+}  // namespace naive
+
+#endif  // BASE_HASH_H_
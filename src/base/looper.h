@@ -11,6 +11,8 @@ using HandlerFunc = std::function<void()>;
 class Looper {
  public:
   virtual void AddFd(int fd, HandlerFunc func) = 0;
+  // Stops polling |fd| and drops its handler. Safe to call from a handler.
+  virtual void RemoveFd(int fd) = 0;
   virtual void AddHandler(HandlerFunc func) = 0;
 };
 
@@ -13,6 +13,14 @@ uint32_t Time::CurrentTimeMilliSeconds() {
           .count());
 }
 
+// static
+uint64_t Time::CurrentTimeMicroSeconds() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
 // static
 std::string Time::GetTime(const char* format) {
   char buffer[256];
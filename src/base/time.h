@@ -10,6 +10,8 @@ namespace base {
 class Time {
  public:
   static uint32_t CurrentTimeMilliSeconds();
+  // Monotonic time, for measuring intervals.
+  static uint64_t CurrentTimeMicroSeconds();
   static std::string GetTime(const char* format);
 };
 
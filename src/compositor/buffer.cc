@@ -1,4 +1,8 @@
 #include "buffer.h"
+
+#include <wayland-server.h>
+
+#include "compositor/compositor.h"
 #include "surface.h"
 #include "wayland/shared_memory.h"
 
@@ -17,10 +21,19 @@ Buffer::Buffer(int32_t width,
       stride_(stride),
       shm_pool_(pool) {}
 
+Buffer::Buffer(uint32_t pixel)
+    : width_(1),
+      height_(1),
+      format_(WL_SHM_FORMAT_ARGB8888),
+      offset_(0),
+      stride_(sizeof(uint32_t)),
+      pixel_(pixel) {}
+
 Buffer::~Buffer() {
   TRACE("%p", this);
   if (owner_)
     owner_->NotifyBufferDestroyed(this);
+  compositor::Compositor::Get()->CancelRelease(this);
 }
 
 void Buffer::SetOwningSurface(Surface* surface) {
@@ -28,8 +41,30 @@ void Buffer::SetOwningSurface(Surface* surface) {
 }
 
 void* Buffer::data() {
+  if (!shm_pool_)
+    return &pixel_;
   uint8_t* p = static_cast<uint8_t*>(shm_pool_->data()) + offset_;
   return static_cast<void*>(p);
 }
 
+bool Buffer::GetDmaBuf(int* fd, uint32_t* id) {
+  if (!shm_pool_)
+    return false;
+  int dmabuf = shm_pool_->dmabuf_fd();
+  if (dmabuf < 0)
+    return false;
+  int64_t end = static_cast<int64_t>(offset_) +
+                static_cast<int64_t>(stride_) * height_;
+  if (end > shm_pool_->dmabuf_size())
+    return false;
+  *fd = dmabuf;
+  *id = shm_pool_->dmabuf_id();
+  return true;
+}
+
+bool Buffer::MaybeImported() {
+  // Textures keep imports of a pool that was since wrapped again.
+  return shm_pool_ && shm_pool_->dmabuf_id();
+}
+
 }  // namespace naive
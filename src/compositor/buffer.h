@@ -24,7 +24,13 @@ class Buffer {
          int32_t offset,
          int32_t stride,
          std::shared_ptr<wayland::ShmPool> pool);
+  // Creates a 1x1 ARGB8888 buffer holding |pixel| without any shm pool.
+  explicit Buffer(uint32_t pixel);
   ~Buffer();
+
+  // Whether clients can allocate dmabuf buffers, which takes linux-dmabuf.
+  static bool DmaBufSupported() { return false; }
+
   void SetOwningSurface(Surface* surface);
   void* data();
 
@@ -39,10 +45,20 @@ class Buffer {
   int32_t format() { return format_; }
   int32_t stride() { return stride_; }
   int32_t offset() { return offset_; }
+  // Gets the dmabuf of the shm pool holding the buffer, and its id, if the
+  // pool could be wrapped as one that covers the whole buffer.
+  bool GetDmaBuf(int* fd, uint32_t* id);
+  // Whether the client allocated the buffer as a dmabuf, rather than in shm
+  // the compositor may wrap as one. Without linux-dmabuf, none is.
+  bool is_dmabuf() { return false; }
+  // Whether the GPU may sample the buffer where it is, through a dmabuf of
+  // its pool, rather than from a copy.
+  bool MaybeImported();
 
  private:
   int32_t width_, height_, format_, offset_, stride_;
   std::shared_ptr<wayland::ShmPool> shm_pool_;
+  uint32_t pixel_ = 0;
   Surface* owner_{nullptr};
   std::function<void()> buffer_release_callback_;
 };
@@ -0,0 +1,215 @@
+#include "compositor/buffer_viewport.h"
+
+#include <wayland-server.h>
+#include <algorithm>
+#include <cmath>
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+base::geometry::Rect RoundRect(float x0, float y0, float x1, float y1,
+                               bool inner) {
+  int32_t left = inner ? std::ceil(x0) : std::floor(x0);
+  int32_t top = inner ? std::ceil(y0) : std::floor(y0);
+  int32_t right = inner ? std::floor(x1) : std::ceil(x1);
+  int32_t bottom = inner ? std::floor(y1) : std::ceil(y1);
+  if (right <= left || bottom <= top)
+    return base::geometry::Rect();
+  return base::geometry::Rect(left, top, right - left, bottom - top);
+}
+
+}  // namespace
+
+void BufferViewport::SetSource(float x, float y, float width, float height) {
+  has_source_ = true;
+  source_x_ = x;
+  source_y_ = y;
+  source_width_ = width;
+  source_height_ = height;
+}
+
+void BufferViewport::SetDestination(int32_t width, int32_t height) {
+  has_destination_ = true;
+  destination_width_ = width;
+  destination_height_ = height;
+}
+
+void BufferViewport::Resolve(int32_t buffer_width, int32_t buffer_height) {
+  buffer_width_ = buffer_width;
+  buffer_height_ = buffer_height;
+  if (!has_source_) {
+    source_x_ = source_y_ = 0;
+    source_width_ = transformed_width();
+    source_height_ = transformed_height();
+  }
+  if (!has_destination_) {
+    destination_width_ = std::lround(source_width_);
+    destination_height_ = std::lround(source_height_);
+  }
+}
+
+bool BufferViewport::scaled() const {
+  return source_width_ != destination_width_ ||
+         source_height_ != destination_height_ ||
+         source_x_ != std::floor(source_x_) ||
+         source_y_ != std::floor(source_y_);
+}
+
+int32_t BufferViewport::transformed_width() const {
+  return swaps_axes() ? buffer_height_ : buffer_width_;
+}
+
+int32_t BufferViewport::transformed_height() const {
+  return swaps_axes() ? buffer_width_ : buffer_height_;
+}
+
+void BufferViewport::ViewToBuffer(float x,
+                                  float y,
+                                  float* buffer_x,
+                                  float* buffer_y) const {
+  if (identity()) {
+    *buffer_x = x;
+    *buffer_y = y;
+    return;
+  }
+  float tx = source_x_;
+  float ty = source_y_;
+  if (destination_width_ > 0)
+    tx += x * source_width_ / destination_width_;
+  if (destination_height_ > 0)
+    ty += y * source_height_ / destination_height_;
+
+  // Undo the transform, which only permutes and mirrors the axes.
+  float width = transformed_width();
+  float height = transformed_height();
+  switch (transform_) {
+    case WL_OUTPUT_TRANSFORM_NORMAL:
+    default:
+      *buffer_x = tx;
+      *buffer_y = ty;
+      break;
+    case WL_OUTPUT_TRANSFORM_90:
+      *buffer_x = ty;
+      *buffer_y = width - tx;
+      break;
+    case WL_OUTPUT_TRANSFORM_180:
+      *buffer_x = width - tx;
+      *buffer_y = height - ty;
+      break;
+    case WL_OUTPUT_TRANSFORM_270:
+      *buffer_x = height - ty;
+      *buffer_y = tx;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED:
+      *buffer_x = width - tx;
+      *buffer_y = ty;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+      *buffer_x = ty;
+      *buffer_y = tx;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+      *buffer_x = tx;
+      *buffer_y = height - ty;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+      *buffer_x = height - ty;
+      *buffer_y = width - tx;
+      break;
+  }
+}
+
+base::geometry::Rect BufferViewport::ViewToBuffer(
+    const base::geometry::Rect& rect) const {
+  float x0, y0, x1, y1;
+  ViewToBuffer(rect.x(), rect.y(), &x0, &y0);
+  ViewToBuffer(rect.x() + rect.width(), rect.y() + rect.height(), &x1, &y1);
+  return RoundRect(std::min(x0, x1), std::min(y0, y1), std::max(x0, x1),
+                   std::max(y0, y1), false);
+}
+
+base::geometry::Rect BufferViewport::BufferToView(
+    const base::geometry::Rect& rect) const {
+  return BufferToView(rect, false);
+}
+
+Region BufferViewport::ViewToBuffer(Region& region) const {
+  Region result = Region::Empty();
+  for (auto& rect : region.rectangles())
+    result.Union(ViewToBuffer(rect));
+  return result;
+}
+
+Region BufferViewport::BufferToView(Region& region, bool inner) const {
+  Region result = Region::Empty();
+  for (auto& rect : region.rectangles())
+    result.Union(BufferToView(rect, inner));
+  return result;
+}
+
+void BufferViewport::BufferToTransformed(float x,
+                                         float y,
+                                         float* transformed_x,
+                                         float* transformed_y) const {
+  float width = transformed_width();
+  float height = transformed_height();
+  switch (transform_) {
+    case WL_OUTPUT_TRANSFORM_NORMAL:
+    default:
+      *transformed_x = x;
+      *transformed_y = y;
+      break;
+    case WL_OUTPUT_TRANSFORM_90:
+      *transformed_x = width - y;
+      *transformed_y = x;
+      break;
+    case WL_OUTPUT_TRANSFORM_180:
+      *transformed_x = width - x;
+      *transformed_y = height - y;
+      break;
+    case WL_OUTPUT_TRANSFORM_270:
+      *transformed_x = y;
+      *transformed_y = height - x;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED:
+      *transformed_x = width - x;
+      *transformed_y = y;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+      *transformed_x = y;
+      *transformed_y = x;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+      *transformed_x = x;
+      *transformed_y = height - y;
+      break;
+    case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+      *transformed_x = width - y;
+      *transformed_y = height - x;
+      break;
+  }
+}
+
+base::geometry::Rect BufferViewport::BufferToView(
+    const base::geometry::Rect& rect,
+    bool inner) const {
+  if (identity())
+    return rect;
+  if (source_width_ <= 0 || source_height_ <= 0)
+    return base::geometry::Rect();
+  float x0, y0, x1, y1;
+  BufferToTransformed(rect.x(), rect.y(), &x0, &y0);
+  BufferToTransformed(rect.x() + rect.width(), rect.y() + rect.height(), &x1,
+                      &y1);
+  float scale_x = destination_width_ / source_width_;
+  float scale_y = destination_height_ / source_height_;
+  return RoundRect((std::min(x0, x1) - source_x_) * scale_x,
+                   (std::min(y0, y1) - source_y_) * scale_y,
+                   (std::max(x0, x1) - source_x_) * scale_x,
+                   (std::max(y0, y1) - source_y_) * scale_y, inner);
+}
+
+}  // namespace compositor
+}  // namespace naive
@@ -0,0 +1,76 @@
+#ifndef COMPOSITOR_BUFFER_VIEWPORT_H_
+#define COMPOSITOR_BUFFER_VIEWPORT_H_
+
+#include <cstdint>
+
+#include "base/geometry.h"
+#include "compositor/region.h"
+
+namespace naive {
+namespace compositor {
+
+// Maps a buffer onto the view showing it. The buffer is first transformed by
+// one of the eight wl_output_transform values, then the view shows the source
+// rectangle of the transformed buffer, in buffer pixels, scaled to the
+// destination size, in view pixels. What is not set defaults to the whole
+// buffer, unscaled, once the viewport is resolved against the buffer size.
+class BufferViewport {
+ public:
+  BufferViewport() = default;
+
+  void SetSource(float x, float y, float width, float height);
+  void SetDestination(int32_t width, int32_t height);
+  void SetTransform(int32_t transform) { transform_ = transform; }
+  // Fills in what was not set for a buffer of the given size.
+  void Resolve(int32_t buffer_width, int32_t buffer_height);
+
+  // Whether buffer and view coordinates are the same.
+  bool identity() const {
+    return !has_source_ && !has_destination_ && transform_ == 0;
+  }
+  bool has_source() const { return has_source_; }
+  bool has_destination() const { return has_destination_; }
+  // Whether buffer pixels do not map one to one onto view pixels.
+  bool scaled() const;
+  // Size of the view, in view pixels.
+  int32_t width() const { return destination_width_; }
+  int32_t height() const { return destination_height_; }
+
+  // Size of the buffer once transformed.
+  int32_t transformed_width() const;
+  int32_t transformed_height() const;
+
+  // Maps the view point (x, y) into the buffer.
+  void ViewToBuffer(float x, float y, float* buffer_x, float* buffer_y) const;
+  // Rectangles are rounded outwards to whole pixels.
+  base::geometry::Rect ViewToBuffer(const base::geometry::Rect& rect) const;
+  base::geometry::Rect BufferToView(const base::geometry::Rect& rect) const;
+  Region ViewToBuffer(Region& region) const;
+  // With |inner|, rectangles are rounded inwards instead, so only pixels
+  // covered completely are kept.
+  Region BufferToView(Region& region, bool inner) const;
+
+ private:
+  base::geometry::Rect BufferToView(const base::geometry::Rect& rect,
+                                    bool inner) const;
+  // Maps the buffer point (x, y) into the transformed buffer.
+  void BufferToTransformed(float x,
+                           float y,
+                           float* transformed_x,
+                           float* transformed_y) const;
+  // Whether the transform turns the buffer by 90 or 270 degrees.
+  bool swaps_axes() const { return transform_ & 1; }
+
+  bool has_source_ = false;
+  bool has_destination_ = false;
+  float source_x_ = 0, source_y_ = 0;
+  float source_width_ = 0, source_height_ = 0;
+  int32_t destination_width_ = 0, destination_height_ = 0;
+  int32_t transform_ = 0;
+  int32_t buffer_width_ = 0, buffer_height_ = 0;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_BUFFER_VIEWPORT_H_
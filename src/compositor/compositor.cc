@@ -1,6 +1,8 @@
 #include "compositor/compositor.h"
 
+#include <algorithm>
 #include <cassert>
+#include <sstream>
 
 #include <GLES3/gl3.h>
 #include <GLES3/gl3ext.h>
@@ -9,12 +11,18 @@
 #include "backend/backend.h"
 #include "backend/egl_context.h"
 #include "base/logging.h"
+#include "base/time.h"
 #include "compositor/buffer.h"
 #include "compositor/compositor_view.h"
 #include "compositor/draw_quad.h"
 #include "compositor/gl_renderer.h"
+#include "compositor/gpu_timer.h"
+#include "compositor/subtree_cache.h"
 #include "compositor/surface.h"
-#include "compositor/texture_delegate.h"
+#include "compositor/texture.h"
+#include "compositor/tile_damage.h"
+#include "compositor/workspace_thumbnails.h"
+#include "config.h"
 #include "resources/cursor.h"
 #include "wm/window.h"
 #include "wm/window_impl.h"
@@ -24,81 +32,10 @@ namespace naive {
 namespace compositor {
 
 namespace {
-class Texture : public TextureDelegate {
- public:
-  Texture(int width,
-          int height,
-          int32_t format,
-          void* data,
-          GlRenderer* renderer)
-      : width_(width), height_(height), identifier_(0), renderer_(renderer) {
-    if (format != WL_SHM_FORMAT_ARGB8888 && format != WL_SHM_FORMAT_XRGB8888) {
-      TRACE("buffer format not WL_SHM_FORMAT_ARGB8888");
-    }
-    needs_backdrop_ = format == WL_SHM_FORMAT_XRGB8888;
-    glGenTextures(1, &identifier_);
-    glBindTexture(GL_TEXTURE_2D, identifier_);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, data);
-    glBindTexture(GL_TEXTURE_2D, 0);
-  }
-
-  ~Texture() {
-    TRACE();
-    if (identifier_)
-      glDeleteTextures(1, &identifier_);
-  }
-
-  void Draw(int x, int y, int patch_x, int patch_y, int width, int height)
-      override {
-    TRACE(
-        "Draw: offset (%d %d) (in buffer offset: %d %d) (dimension: %d %d), "
-        "texture dimension: (%d %d)",
-        x, y, patch_x, patch_y, width, height, width_, height_);
-    if (!identifier_)
-      return;
-
-    if (width_ == 0)
-      width_ = 1;
-    if (height_ == 0)
-      height_ = 1;
-    if (width > width_)
-      width = width_;
-    if (height > height_)
-      height = height_;
-
-    GLint vertices[] = {x + patch_x,         y + patch_y + height, x + patch_x,
-                        y + patch_y,         x + patch_x + width,  y + patch_y,
-                        x + patch_x + width, y + patch_y + height};
-    float top_left_x = ((float)patch_x) / width_;
-    float top_left_y = ((float)patch_y) / height_;
-    float bottom_right_x = ((float)(patch_x + width)) / width_;
-    float bottom_right_y = ((float)(patch_y + height)) / height_;
-
-    TRACE("Texture coord: tl (%f %f), br (%f %f)", top_left_x, top_left_y,
-          bottom_right_x, bottom_right_y);
-
-    GLfloat tex_coords[] = {
-        top_left_x,     bottom_right_y, top_left_x,     top_left_y,
-        bottom_right_x, top_left_y,     bottom_right_x, bottom_right_y,
-    };
-
-    if (needs_backdrop_) {
-      glDisable(GL_BLEND);
-      renderer_->DrawTextureQuad(vertices, tex_coords, identifier_);
-      glEnable(GL_BLEND);
-    } else
-      renderer_->DrawTextureQuad(vertices, tex_coords, identifier_);
-  }
 
- private:
-  GLuint identifier_;
-  GlRenderer* renderer_;
-  int32_t width_, height_;
-  bool needs_backdrop_{false};
-};
+// How often frame callbacks are sent while no frame is drawn, so nothing
+// else paces them, about once per refresh.
+constexpr uint64_t kIdleCallbackIntervalUs = 16667;
 
 }  // namespace
 
@@ -119,9 +56,14 @@ Compositor::Compositor(backend::Backend* backend)
     : backend_(backend),
       egl_(backend->egl()),
       display_metrics_(backend->display_metrics()) {
-  egl_->EnableBlend(true);
   renderer_ = std::make_unique<GlRenderer>(display_metrics_->width_pixels,
                                            display_metrics_->height_pixels);
+  gpu_timer_ = std::make_unique<GpuTimer>();
+  output_damage_ = std::make_unique<TileDamage>(
+      display_metrics_->width_pixels, display_metrics_->height_pixels);
+  thumbnails_ = std::make_unique<WorkspaceThumbnails>(
+      renderer_.get(), display_metrics_->width_pixels,
+      display_metrics_->height_pixels);
 }
 
 void Compositor::AddGlobalDamage(const base::geometry::Rect& rect,
@@ -134,10 +76,127 @@ wayland::DisplayMetrics* Compositor::GetDisplayMetrics() {
 }
 
 void Compositor::Draw() {
+  DrawScene();
+  // The cursor and screen copies are never held back with the scene.
+  if (backend_->SupportHwCursor())
+    DrawPointer();
+  ServeCopyRequest();
+}
+
+void Compositor::DrawScene() {
+  // A frame is built in stages. While the previous frame still waits for its
+  // page flip, the next one is snapshotted, uploaded and recorded into the
+  // draw buffer, and it is submitted once the flip completes. At most one
+  // frame is recorded per flip, which also paces frame callbacks.
+  RetireFrames();
+  bool flip_pending = backend_->FlipPending();
+  if (frame_recorded_) {
+    if (flip_pending)
+      return;
+    frame_recorded_ = false;
+    SubmitFrame(recorded_did_draw_, recorded_switch_timing_);
+    return;
+  }
+
+  // The last layout change is shown once the windows it resized drew at
+  // their new size. Meanwhile every window still gets frame callbacks once
+  // per refresh, as clients wait for one before they redraw.
+  auto* transaction = wm::WindowManager::Get()->layout_transaction();
+  if (transaction->Holding()) {
+    uint64_t now = base::Time::CurrentTimeMicroSeconds();
+    if (now - last_callbacks_us_ >= kIdleCallbackIntervalUs)
+      SendFrameCallbacks(BuildViewList(), true);
+    return;
+  }
+
   // egl_->MakeCurrent();
-  egl_->BindDrawBuffer(true);
+  Frame frame;
+  frame.switch_timing.start_us = switch_start_us_;
+  switch_start_us_ = 0;
+  uint64_t start = base::Time::CurrentTimeMicroSeconds();
+  renderer_->BeginFrame();
+  gpu_timer_->BeginFrame();
+  TRACE("GL calls in last frame: %u", renderer_->gl_calls_last_frame());
+  SnapshotScene(&frame);
+  uint64_t snapshotted = base::Time::CurrentTimeMicroSeconds();
+  gpu_timer_->Begin(GpuTimer::kPhaseUpload);
+  UploadTextures(&frame);
+  gpu_timer_->End(GpuTimer::kPhaseUpload);
+  uint64_t uploaded = base::Time::CurrentTimeMicroSeconds();
+  gpu_timer_->Begin(GpuTimer::kPhaseComposite);
+  bool did_draw = RecordFrame(&frame);
+  gpu_timer_->End(GpuTimer::kPhaseComposite);
+  uint64_t recorded = base::Time::CurrentTimeMicroSeconds();
+  stage_timings_[kStageSnapshot].Add(snapshotted - start);
+  stage_timings_[kStageUpload].Add(uploaded - snapshotted);
+  stage_timings_[kStageRecord].Add(recorded - uploaded);
+
+  if (flip_pending) {
+    frame_recorded_ = true;
+    recorded_did_draw_ = did_draw;
+    recorded_switch_timing_ = frame.switch_timing;
+    return;
+  }
+  SubmitFrame(did_draw, frame.switch_timing);
+}
+
+void Compositor::SnapshotScene(Frame* frame) {
+  frame->has_wallpaper = !!wm::WindowManager::Get()->wallpaper_window();
+  frame->views = BuildViewList();
+  CompositorViewList& view_list = frame->views;
+
+  frame->has_global_damage = !global_damage_region_.is_empty();
+
+  if (frame->has_global_damage) {
+    for (auto& v : view_list) {
+      auto additional_damage = global_damage_region_.Clone();
+      additional_damage.Intersect(v->global_region());
+      v->damaged_region().Union(additional_damage);
+    }
+  }
+
+  // Damage hidden by views above still counts for the output, as they may
+  // be translucent.
+  for (auto& v : view_list) {
+    for (auto& rect : v->damaged_region().rectangles())
+      output_damage_->Add(rect);
+  }
+  for (auto& rect : global_damage_region_.rectangles())
+    output_damage_->Add(rect);
+  DamageSceneChanges(view_list);
+
+  for (int i = 0; i < view_list.size(); i++) {
+    for (int j = i + 1; j < view_list.size(); j++) {
+      // TRACE("subtracting %p: %s, from %p", view_list[j]->window(),
+      //      view_list[j]->global_bounds().ToString().c_str(),
+      //      view_list[i]->window());
+      view_list[i]->damaged_region().Subtract(view_list[j]->global_region());
+    }
+  }
+
+  frame->has_any_commit = !global_damage_region_.is_empty();
+  if (thumbnails_->NeedsRefresh()) {
+    frame->refresh_thumbnails = true;
+    frame->has_any_commit = true;
+  }
+
+  if (!global_damage_region_.is_empty())
+    global_damage_region_.Clear();
+
+  for (auto& view : view_list) {
+    if (view->window()->window_impl()->HasCommit())
+      frame->has_any_commit = true;
+  }
+
+  // A frame with commits is drawn and paced by its page flip; without any,
+  // frame callbacks are paced here.
+  SendFrameCallbacks(view_list, frame->has_any_commit);
+}
+
+CompositorViewList Compositor::BuildViewList() {
+  CompositorViewList view_list;
   auto* wallpaper_window = wm::WindowManager::Get()->wallpaper_window();
-  CompositorViewList view_list =
+  view_list =
       wallpaper_window ? CompositorView::BuildCompositorViewHierarchyRecursive(
                              wallpaper_window, display_metrics_->scale)
                        : CompositorViewList();
@@ -176,104 +235,273 @@ void Compositor::Draw() {
     view_list.insert(view_list.end(), std::make_move_iterator(views.begin()),
                      std::make_move_iterator(views.end()));
   }
+  return view_list;
+}
 
-  bool has_global_damage = !global_damage_region_.is_empty();
+void Compositor::DamageSceneChanges(const CompositorViewList& views) {
+  std::vector<ViewState> current;
+  current.reserve(views.size());
+  for (auto& view : views) {
+    current.push_back(
+        {view->window(), view->global_bounds(), view->window()->focused()});
+  }
+  // Views are compared by position in the stack, so a restacked or removed
+  // view damages the ones it shifted as well.
+  for (size_t i = 0; i < std::max(current.size(), last_views_.size()); i++) {
+    const ViewState* now = i < current.size() ? &current[i] : nullptr;
+    const ViewState* last = i < last_views_.size() ? &last_views_[i] : nullptr;
+    if (now && last && now->window == last->window &&
+        now->focused == last->focused && now->bounds.x() == last->bounds.x() &&
+        now->bounds.y() == last->bounds.y() &&
+        now->bounds.width() == last->bounds.width() &&
+        now->bounds.height() == last->bounds.height())
+      continue;
+    if (now)
+      output_damage_->Add(now->bounds);
+    if (last)
+      output_damage_->Add(last->bounds);
+  }
+  last_views_ = std::move(current);
+}
 
-  if (has_global_damage) {
-    for (auto& v : view_list) {
-      auto additional_damage = global_damage_region_.Clone();
-      additional_damage.Intersect(v->global_region());
-      v->damaged_region().Union(additional_damage);
+void Compositor::SendFrameCallbacks(const CompositorViewList& views,
+                                    bool force) {
+  uint64_t now = base::Time::CurrentTimeMicroSeconds();
+  if (!force && now - last_callbacks_us_ < kIdleCallbackIntervalUs)
+    return;
+  last_callbacks_us_ = now;
+  for (auto& view : views)
+    view->window()->NotifyFrameCallback();
+}
+
+void Compositor::UploadTextures(Frame* frame) {
+  if (!frame->has_any_commit)
+    return;
+
+  CompositorViewList& view_list = frame->views;
+  // Walk from top to bottom, so each view knows what is covered by opaque
+  // views above it. Only the visible part of a buffer is uploaded.
+  Region covered = Region::Empty();
+  base::geometry::Rect screen(0, 0, display_metrics_->width_pixels,
+                              display_metrics_->height_pixels);
+  for (auto iter = view_list.rbegin(); iter != view_list.rend(); ++iter) {
+    auto& view = *iter;
+    auto* window = view->window();
+    auto bounds = view->global_bounds();
+    view->visible_region() = view->draw_region().Clone();
+    view->visible_region().Intersect(screen);
+    view->visible_region().Subtract(covered);
+
+    // Damage is in buffer coordinates and tells the texture which part of
+    // the buffer to upload.
+    Region damage = window->window_impl()->DamagedRegion().Clone();
+    window->window_impl()->ClearDamage();
+    // window->NotifyFrameCallback();
+
+    bool has_commit = window->window_impl()->HasCommit();
+    if (has_commit) {
+      window->window_impl()->ClearCommit();
+      frame->changed_subtrees.insert(window->top_level());
+    }
+    // Textures released while their window was hidden are uploaded again.
+    auto* texture = window->window_impl()->CachedTexture();
+    if (has_commit || !texture || texture->HasPendingDamage()) {
+      auto quad = window->window_impl()->GetQuad();
+      if (quad.has_data()) {
+        if (!texture) {
+          window->window_impl()->CacheTexture(
+              std::make_unique<Texture>(renderer_.get()));
+          texture = window->window_impl()->CachedTexture();
+        }
+        texture->SetViewport(view->viewport());
+        Region visible =
+            view->visible_region().Translate(-bounds.x(), -bounds.y());
+        UploadStats stats = texture->Update(quad, damage, visible);
+        if (stats.bytes_uploaded)
+          frame->changed_subtrees.insert(window->top_level());
+        frame->switch_timing.bytes_uploaded += stats.bytes_uploaded;
+        upload_stats_[window->GetPid()] += stats;
+      }
     }
-  }
 
-  for (int i = 0; i < view_list.size(); i++) {
-    for (int j = i + 1; j < view_list.size(); j++) {
-      // TRACE("subtracting %p: %s, from %p", view_list[j]->window(),
-      //      view_list[j]->global_bounds().ToString().c_str(),
-      //      view_list[i]->window());
-      view_list[i]->damaged_region().Subtract(view_list[j]->global_region());
+    if (texture) {
+      // The viewport also changes with commits that bring no new buffer.
+      texture->SetViewport(view->viewport());
+      Region opaque = window->window_impl()->OpaqueRegion();
+      Region inferred = texture->OpaqueRegion();
+      opaque.Union(inferred);
+      view->SetOpaqueRegion(opaque);
+      covered.Union(view->opaque_region());
     }
   }
 
-  bool has_any_commit = !global_damage_region_.is_empty();
+  for (auto* top_level : frame->changed_subtrees)
+    thumbnails_->OnWindowChanged(top_level);
+}
 
-  if (!global_damage_region_.is_empty())
-    global_damage_region_.Clear();
+void Compositor::UpdateSubtreeCaches(Frame* frame) {
+  CompositorViewList& view_list = frame->views;
+  frame->view_caches.assign(view_list.size(), nullptr);
+  std::set<wm::Window*> seen;
+  size_t begin = 0;
+  while (begin < view_list.size()) {
+    wm::Window* top_level = view_list[begin]->window()->top_level();
+    size_t end = begin + 1;
+    while (end < view_list.size() &&
+           view_list[end]->window()->top_level() == top_level)
+      end++;
+
+    // A single view gains nothing from a copy.
+    if (end - begin > 1) {
+      seen.insert(top_level);
+      auto& cache = subtree_caches_[top_level];
+      if (!cache)
+        cache = std::make_unique<SubtreeCache>(renderer_.get());
+      std::vector<CompositorView*> views;
+      for (size_t i = begin; i < end; i++)
+        views.push_back(view_list[i].get());
+      if (cache->Update(views, frame->changed_subtrees.count(top_level))) {
+        for (size_t i = begin; i < end; i++)
+          frame->view_caches[i] = cache.get();
+      }
+    }
+    begin = end;
+  }
 
-  for (auto& view : view_list) {
-    auto* window = view->window();
-    window->NotifyFrameCallback();
-    if (window->window_impl()->HasCommit())
-      has_any_commit = true;
+  // Copies of subtrees that are gone or hidden are dropped.
+  for (auto iter = subtree_caches_.begin(); iter != subtree_caches_.end();) {
+    if (seen.count(iter->first))
+      ++iter;
+    else
+      iter = subtree_caches_.erase(iter);
   }
+}
 
+bool Compositor::RecordFrame(Frame* frame) {
+  CompositorViewList& view_list = frame->views;
   bool did_draw = false;
-  if (has_any_commit) {
+  if (frame->has_any_commit)
+    UpdateSubtreeCaches(frame);
+  if (frame->refresh_thumbnails) {
+    thumbnails_->Refresh(display_metrics_->scale);
+    for (auto& slot : thumbnails_->refreshed_slots())
+      output_damage_->Add(slot);
+#ifndef __NAIVE_COMPOSITOR__
+    // Refreshed thumbnails damage the panel they are drawn over.
+    auto* panel_window = wm::WindowManager::Get()->panel_window();
     for (auto& view : view_list) {
-      has_any_commit = false;
-      auto* window = view->window();
-      window->window_impl()->ClearDamage();
-      // window->NotifyFrameCallback();
-
-      if (window->window_impl()->HasCommit()) {
-        window->window_impl()->ClearCommit();
-        has_any_commit = true;
-        auto quad = window->window_impl()->GetQuad();
-        if (quad.has_data()) {
-          auto texture = std::make_unique<Texture>(quad.width(), quad.height(),
-                                                   quad.format(), quad.data(),
-                                                   renderer_.get());
-          window->window_impl()->CacheTexture(std::move(texture));
-        }
+      if (view->window() != panel_window)
+        continue;
+      for (auto& slot : thumbnails_->refreshed_slots())
+        view->damaged_region().Union(slot);
+    }
+#endif
+  }
+  egl_->BindDrawBuffer(true);
+  if (frame->has_any_commit) {
+    // What each view draws, bottom to top. A cached subtree is drawn once,
+    // at its bottom view, over the part any of its views shows.
+    struct ViewDraw {
+      CompositorView* view;
+      SubtreeCache* cache;
+      std::vector<base::geometry::Rect> rectangles;
+    };
+    std::vector<ViewDraw> draws;
+    for (size_t i = 0; i < view_list.size(); i++) {
+      auto& view = view_list[i];
+      SubtreeCache* cache = frame->view_caches[i];
+      size_t end = i + 1;
+      if (cache) {
+        if (i > 0 && frame->view_caches[i - 1] == cache)
+          continue;
+        while (end < view_list.size() && frame->view_caches[end] == cache)
+          end++;
       }
+      Region visible = view->visible_region().Clone();
+      for (size_t j = i + 1; j < end; j++)
+        visible.Union(view_list[j]->visible_region());
 #ifdef __NAIVE_COMPOSITOR__
-      auto rectangles =
-          std::vector<base::geometry::Rect>{view->global_bounds()};
+      draws.push_back({view.get(), cache, visible.rectangles()});
 #else
-      auto rectangles(view->damaged_region().rectangles());
+      Region damaged = view->damaged_region().Clone();
+      for (size_t j = i + 1; j < end; j++)
+        damaged.Union(view_list[j]->damaged_region());
+      draws.push_back({view.get(), cache, damaged.rectangles()});
 #endif
-      for (auto& rect : rectangles) {
-        auto bounds = view->global_bounds();
-        TRACE("rectangle: %s, window %p, global bounds: %s, did draw: %d",
-              rect.ToString().c_str(), view->window(),
-              bounds.ToString().c_str(), did_draw);
-        if (window->window_impl()->CachedTexture()) {
-          int32_t physical_x = bounds.x();  // * display_metrics_->scale;
-          int32_t physical_y = bounds.y();  // * display_metrics_->scale;
-          int32_t to_draw_x =
-              (rect.x() - bounds.x());  // * display_metrics_->scale;
-          int32_t to_draw_y =
-              (rect.y() - bounds.y());            // * display_metrics_->scale;
-          int32_t physical_width = rect.width();  // * display_metrics_->scale;
-          int32_t physical_height =
-              rect.height();  // * display_metrics_->scale;
+    }
+
+    // Opaque parts are drawn first, front to back with depth writes and
+    // blending disabled, so fragments hidden by views above are rejected
+    // before shading. Blending is then enabled once for everything else,
+    // drawn back to front and depth tested against the opaque parts.
+    auto depth_of = [&draws](size_t index) {
+      return 1.0f - 2.0f * (index + 1) / (draws.size() + 1);
+    };
+    // Borders of top-level windows are drawn by the shaders along with
+    // their content, so views above cover them like any other content.
+    auto set_border = [this](CompositorView* view) {
+      auto* window = view->window();
+      if (window->parent() || !window->has_border()) {
+        renderer_->ClearBorder();
+        return;
+      }
+      if (window->focused())
+        renderer_->SetBorder(view->global_bounds(), 1, 0.0, 1.0, 1.0);
+      else
+        renderer_->SetBorder(view->global_bounds(), 1, 0.0, 0.3, 0.3);
+    };
+    renderer_->ClearDepth();
+    renderer_->SetDepthTest(true, true);
+    renderer_->SetBlend(false);
+    for (size_t i = draws.size(); i-- > 0;) {
+      auto& draw = draws[i];
+      auto* texture = draw.view->window()->window_impl()->CachedTexture();
+      if (draw.cache || !texture)
+        continue;
+      renderer_->SetDepth(depth_of(i));
+      set_border(draw.view);
+      auto bounds = draw.view->global_bounds();
+      for (auto& rect : draw.rectangles) {
+        texture->Draw(bounds.x(), bounds.y(), rect.x() - bounds.x(),
+                      rect.y() - bounds.y(), rect.width(), rect.height(),
+                      DrawPass::kOpaque);
+      }
+    }
+    renderer_->SetDepthTest(true, false);
+    renderer_->SetBlend(true);
+
+    for (size_t i = 0; i < draws.size(); i++) {
+      auto& draw = draws[i];
+      auto* window = draw.view->window();
+      auto& rectangles = draw.rectangles;
+      renderer_->SetDepth(depth_of(i));
+      set_border(draw.view);
+      if (draw.cache) {
+        draw.cache->Draw(rectangles);
+        did_draw = did_draw || !rectangles.empty();
+      } else if (window->window_impl()->CachedTexture()) {
+        auto bounds = draw.view->global_bounds();
+        for (auto& rect : rectangles) {
+          TRACE("rectangle: %s, window %p, global bounds: %s",
+                rect.ToString().c_str(), window, bounds.ToString().c_str());
           window->window_impl()->CachedTexture()->Draw(
-              physical_x, physical_y, to_draw_x, to_draw_y, physical_width,
-              physical_height);
-          did_draw = true;
+              bounds.x(), bounds.y(), rect.x() - bounds.x(),
+              rect.y() - bounds.y(), rect.width(), rect.height(),
+              DrawPass::kTranslucent);
         }
+        did_draw = did_draw || !rectangles.empty();
       }
-    }
-  }
-
-  if (did_draw) {
-    for (int i = 0; i < view_list.size(); i++) {
-      for (int j = i + 1; j < view_list.size(); j++)
-        view_list[i]->border_region().Subtract(view_list[j]->global_region());
-      for (auto& rect : view_list[i]->border_region().rectangles()) {
-        if (!view_list[i]->window()->has_border())
-          continue;
-        if (view_list[i]->window()->focused() &&
-            !view_list[i]->window()->parent())
-          FillRect(rect, 0.0, 1.0, 1.0);
-        else
-          FillRect(rect, 0.0, 0.3, 0.3);
+      // Thumbnails go right above the panel, so windows above cover them.
+      if (window == wm::WindowManager::Get()->panel_window()) {
+        renderer_->ClearBorder();
+        thumbnails_->Draw(rectangles);
       }
     }
+    renderer_->ClearBorder();
+    renderer_->SetDepthTest(false, true);
   }
 
-  if (has_global_damage && !wallpaper_window) {
+  if (frame->has_global_damage && !frame->has_wallpaper) {
     Region full_screen = Region(base::geometry::Rect(
         0, 0, display_metrics_->width_dp, display_metrics_->height_dp));
     for (auto& v : view_list)
@@ -284,27 +512,222 @@ void Compositor::Draw() {
       FillRect(r, 0.0, 0.0, 0.0);
     }
   }
+  return did_draw;
+}
 
+void Compositor::SubmitFrame(bool did_draw, SwitchTiming switch_timing) {
+  uint64_t start = base::Time::CurrentTimeMicroSeconds();
   egl_->BindDrawBuffer(false);
 
-  if (did_draw)
-    egl_->BlitFrameBuffer();
-
-  if (copy_request_) {
-    std::vector<uint8_t> screen_data;
-    screen_data.resize(sizeof(uint32_t) * display_metrics_->width_pixels *
-                       display_metrics_->height_pixels);
-    glReadPixels(0, 0, display_metrics_->width_pixels,
-                 display_metrics_->height_pixels, GL_RGBA, GL_UNSIGNED_BYTE,
-                 screen_data.data());
-    (*copy_request_)(std::move(screen_data), display_metrics_->width_pixels,
-                     display_metrics_->height_pixels);
-    copy_request_.reset();
+  if (did_draw) {
+    // Only what changed since the back buffer was last shown is copied to
+    // it, all of it if its age is unknown.
+    auto rects = output_damage_->ToRects(
+        output_damage_->Accumulate(egl_->BufferAge()));
+    gpu_timer_->Begin(GpuTimer::kPhaseBlit);
+    egl_->BlitFrameBuffer(rects);
+    gpu_timer_->End(GpuTimer::kPhaseBlit);
+    output_damage_->NextFrame();
   }
+  gpu_timer_->EndFrame();
 
   backend_->FinalizeDraw(did_draw);
-  if (backend_->SupportHwCursor())
-    DrawPointer();
+  // The GPU may still read released buffers, they are released by
+  // RetireFrames() once a fence placed after the frame signaled.
+  if (!release_buffers_.empty() || !release_points_.empty()) {
+    RetiringFrame retiring;
+    retiring.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    retiring.buffers = std::move(release_buffers_);
+    release_buffers_.clear();
+    retiring.release_points = std::move(release_points_);
+    release_points_.clear();
+    retiring_frames_.push_back(std::move(retiring));
+  }
+  uint64_t end = base::Time::CurrentTimeMicroSeconds();
+  stage_timings_[kStageSubmit].Add(end - start);
+  if (switch_timing.start_us) {
+    switch_latency_.Add(end - switch_timing.start_us);
+    switch_bytes_uploaded_ += switch_timing.bytes_uploaded;
+    TRACE("workspace switch took %lu us, uploaded %lu bytes",
+          end - switch_timing.start_us, switch_timing.bytes_uploaded);
+  }
+}
+
+void Compositor::ServeCopyRequest() {
+  if (!copy_request_)
+    return;
+  egl_->BindDrawBuffer(true);
+  std::vector<uint8_t> screen_data;
+  screen_data.resize(sizeof(uint32_t) * display_metrics_->width_pixels *
+                     display_metrics_->height_pixels);
+  glReadPixels(0, 0, display_metrics_->width_pixels,
+               display_metrics_->height_pixels, GL_RGBA, GL_UNSIGNED_BYTE,
+               screen_data.data());
+  (*copy_request_)(std::move(screen_data), display_metrics_->width_pixels,
+                   display_metrics_->height_pixels);
+  copy_request_.reset();
+}
+
+void Compositor::ReleaseAfterFrame(Buffer* buffer) {
+  release_buffers_.push_back(buffer);
+}
+
+void Compositor::CancelRelease(Buffer* buffer) {
+  release_buffers_.erase(
+      std::remove(release_buffers_.begin(), release_buffers_.end(), buffer),
+      release_buffers_.end());
+  for (auto& frame : retiring_frames_) {
+    frame.buffers.erase(
+        std::remove(frame.buffers.begin(), frame.buffers.end(), buffer),
+        frame.buffers.end());
+  }
+}
+
+void Compositor::RetireFrames() {
+  while (!retiring_frames_.empty()) {
+    auto& frame = retiring_frames_.front();
+    if (glClientWaitSync(frame.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+      return;
+    glDeleteSync(frame.fence);
+    for (auto* buffer : frame.buffers)
+      buffer->Release();
+    // Signaled from the CPU, which is safe as the GPU finished every
+    // command reading the buffers by now.
+    for (auto& point : frame.release_points)
+      point.timeline->Signal(point.point);
+    retiring_frames_.pop_front();
+  }
+}
+
+void Compositor::DumpStats() {
+  LOG_INFO << "texture upload stats:" << std::endl;
+  for (auto& entry : upload_stats_) {
+    LOG_INFO << "  pid " << entry.first << ": uploaded "
+             << entry.second.bytes_uploaded << " bytes, skipped "
+             << entry.second.bytes_skipped << " bytes, imported "
+             << entry.second.bytes_imported << " bytes" << std::endl;
+  }
+
+  static const char* kStageNames[kStageCount] = {"snapshot", "upload",
+                                                 "record", "submit"};
+  LOG_INFO << "frame stage timings:" << std::endl;
+  for (int i = 0; i < kStageCount; i++) {
+    auto& timing = stage_timings_[i];
+    if (!timing.count)
+      continue;
+    LOG_INFO << "  " << kStageNames[i] << ": average "
+             << timing.total_us / timing.count << " us, max " << timing.max_us
+             << " us over " << timing.count << " frames" << std::endl;
+  }
+
+  if (switch_latency_.count) {
+    LOG_INFO << "workspace switch latency: average "
+             << switch_latency_.total_us / switch_latency_.count
+             << " us, max " << switch_latency_.max_us << " us, uploaded "
+             << switch_bytes_uploaded_ / switch_latency_.count
+             << " bytes on average over " << switch_latency_.count
+             << " switches" << std::endl;
+  }
+
+  LOG_INFO << "GL calls in last frame: " << renderer_->gl_calls_last_frame()
+           << std::endl;
+
+  if (!gpu_timer_->supported())
+    return;
+  static const char* kPhaseNames[GpuTimer::kPhaseCount] = {
+      "upload", "composite", "blit"};
+  LOG_INFO << "GPU time per frame, last " << GpuTimeHistogram::kWindow
+           << " frames:" << std::endl;
+  for (int i = 0; i <= GpuTimer::kPhaseCount; i++) {
+    bool total = i == GpuTimer::kPhaseCount;
+    auto& histogram =
+        total ? gpu_timer_->frame_histogram()
+              : gpu_timer_->histogram(static_cast<GpuTimer::Phase>(i));
+    if (!histogram.count())
+      continue;
+    std::ostringstream buckets;
+    for (size_t b = 0; b < GpuTimeHistogram::kBuckets; b++) {
+      uint64_t limit = GpuTimeHistogram::BucketLimitUs(b);
+      if (limit)
+        buckets << " <" << limit << "us:" << histogram.buckets()[b];
+      else
+        buckets << " more:" << histogram.buckets()[b];
+    }
+    LOG_INFO << "  " << (total ? "frame" : kPhaseNames[i]) << ": average "
+             << histogram.average_ns() / 1000 << " us, max "
+             << histogram.max_ns() / 1000 << " us," << buckets.str()
+             << std::endl;
+  }
+}
+
+void Compositor::OnWindowVisibilityChanged(wm::Window* window,
+                                           bool visible) {
+  hidden_windows_.remove(window);
+  if (visible)
+    return;
+  hidden_windows_.push_back(window);
+  EvictHiddenTextures();
+}
+
+void Compositor::OnWindowDestroyed(wm::Window* window) {
+  hidden_windows_.remove(window);
+  subtree_caches_.erase(window);
+  thumbnails_->OnWindowDestroyed(window);
+}
+
+void Compositor::SetWorkspaceThumbnailSlots(
+    const std::vector<base::geometry::Rect>& slots) {
+  thumbnails_->SetSlots(slots);
+}
+
+void Compositor::SetWorkspaceWindows(size_t workspace,
+                                     const std::vector<wm::Window*>& windows) {
+  thumbnails_->SetWindows(workspace, windows);
+}
+
+void Compositor::OnHiddenWindowCommit(wm::Window* window) {
+  thumbnails_->OnWindowChanged(window->top_level());
+}
+
+void Compositor::MarkWorkspaceSwitch() {
+  switch_start_us_ = base::Time::CurrentTimeMicroSeconds();
+}
+
+void Compositor::EvictHiddenTextures() {
+  // Textures of a hidden window and its subsurfaces, by window.
+  std::vector<std::pair<wm::Window*, uint64_t>> usage;
+  uint64_t total = 0;
+  for (auto* window : hidden_windows_) {
+    uint64_t size = 0;
+    std::vector<wm::Window*> stack = {window};
+    while (!stack.empty()) {
+      auto* w = stack.back();
+      stack.pop_back();
+      if (w->window_impl()->CachedTexture())
+        size += w->window_impl()->CachedTexture()->MemorySize();
+      stack.insert(stack.end(), w->children().begin(), w->children().end());
+    }
+    usage.push_back(std::make_pair(window, size));
+    total += size;
+  }
+
+  for (auto& entry : usage) {
+    if (total <= config::kHiddenTextureBudgetBytes)
+      break;
+    if (!entry.second)
+      continue;
+    TRACE("releasing %lu bytes of textures of hidden window %p", entry.second,
+          entry.first);
+    std::vector<wm::Window*> stack = {entry.first};
+    while (!stack.empty()) {
+      auto* w = stack.back();
+      stack.pop_back();
+      w->window_impl()->CacheTexture(nullptr);
+      stack.insert(stack.end(), w->children().begin(), w->children().end());
+    }
+    total -= entry.second;
+  }
 }
 
 void Compositor::FillRect(base::geometry::Rect rect,
@@ -323,7 +746,7 @@ void Compositor::FillRect(base::geometry::Rect rect,
       x + rect.width(),
       y,
   };
-  renderer_->DrawSolidQuad(coords, r, g, b, true);
+  renderer_->DrawSolidQuad(coords, r, g, b, 1.0, true);
 }
 
 void Compositor::DrawWindowBorder(wm::Window* window) {
@@ -344,9 +767,9 @@ void Compositor::DrawWindowBorder(wm::Window* window) {
       y,
   };
   if (window->focused())
-    renderer_->DrawSolidQuad(coords, 1.0, 0.0, 0.0, false);
+    renderer_->DrawSolidQuad(coords, 1.0, 0.0, 0.0, 1.0, false);
   else
-    renderer_->DrawSolidQuad(coords, 0.0, 1.0, 0.0, false);
+    renderer_->DrawSolidQuad(coords, 0.0, 1.0, 0.0, 1.0, false);
 }
 
 void Compositor::DrawPointer() {
@@ -1,16 +1,26 @@
 #ifndef COMPOSITOR_COMPOSITOR_H_
 #define COMPOSITOR_COMPOSITOR_H_
 
+#include <GLES3/gl3.h>
+#include <sys/types.h>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <list>
+#include <map>
 #include <memory>
+#include <set>
 #include <vector>
 
 #include "base/geometry.h"
 #include "compositor/region.h"
+#include "compositor/sync_timeline.h"
+#include "compositor/texture_delegate.h"
 #include "wayland/display_metrics.h"
 
 namespace naive {
+class Buffer;
+
 namespace backend {
 class EglContext;
 class Backend;
@@ -22,8 +32,14 @@ class Window;
 
 namespace compositor {
 
+class CompositorView;
 class GlRenderer;
+class GpuTimer;
+class SubtreeCache;
+class TileDamage;
+class WorkspaceThumbnails;
 
+using CompositorViewList = std::vector<std::unique_ptr<CompositorView>>;
 using CopyRequest = std::function<void(std::vector<uint8_t>, int32_t, int32_t)>;
 
 class Compositor {
@@ -48,7 +64,125 @@ class Compositor {
 
   void AddGlobalDamage(const base::geometry::Rect& rect, wm::Window* window);
 
+  // Keeps track of hidden top-level windows, whose textures are kept within a
+  // memory budget.
+  void OnWindowVisibilityChanged(wm::Window* window, bool visible);
+  void OnWindowDestroyed(wm::Window* window);
+
+  // Sets where workspace thumbnails are drawn over the panel, one slot per
+  // workspace, and which top-level windows each workspace holds.
+  void SetWorkspaceThumbnailSlots(
+      const std::vector<base::geometry::Rect>& slots);
+  void SetWorkspaceWindows(size_t workspace,
+                           const std::vector<wm::Window*>& windows);
+  // Called when a window of a hidden workspace committed, which no frame
+  // picks up, so its workspace thumbnail is refreshed.
+  void OnHiddenWindowCommit(wm::Window* window);
+
+  // Starts timing a workspace switch, which ends when the first frame showing
+  // it is submitted.
+  void MarkWorkspaceSwitch();
+
+  // Signals |point| once the GPU finished the next frame submitted, which is
+  // the last one that can read from the buffer it releases.
+  void SignalAfterFrame(const SyncPoint& point) {
+    release_points_.push_back(point);
+  }
+  // Releases |buffer|, which the GPU may sample in place, once the GPU
+  // finished the next frame submitted.
+  void ReleaseAfterFrame(Buffer* buffer);
+  // Drops a release still to be sent, for a buffer attached again or
+  // destroyed.
+  void CancelRelease(Buffer* buffer);
+
+  // Logs texture upload statistics per client, frame stage timings and
+  // workspace switch latency.
+  void DumpStats();
+  const std::map<pid_t, UploadStats>& upload_stats() { return upload_stats_; }
+
  private:
+  // A workspace switch, from the request until its frame is submitted.
+  struct SwitchTiming {
+    uint64_t start_us = 0;
+    uint64_t bytes_uploaded = 0;
+  };
+
+  // A submitted frame the GPU may still be drawing, and the buffers and
+  // release points to release once it is done.
+  struct RetiringFrame {
+    GLsync fence;
+    std::vector<Buffer*> buffers;
+    std::vector<SyncPoint> release_points;
+  };
+
+  // State of one frame, handed from one stage of Draw() to the next.
+  struct Frame {
+    std::vector<std::unique_ptr<CompositorView>> views;
+    bool has_wallpaper = false;
+    bool has_global_damage = false;
+    bool has_any_commit = false;
+    bool refresh_thumbnails = false;
+    // Top-level windows whose subtree changed content this frame.
+    std::set<wm::Window*> changed_subtrees;
+    // The subtree copy each view is drawn from, if any.
+    std::vector<SubtreeCache*> view_caches;
+    SwitchTiming switch_timing;
+  };
+
+  enum Stage {
+    kStageSnapshot = 0,
+    kStageUpload,
+    kStageRecord,
+    kStageSubmit,
+    kStageCount,
+  };
+
+  // Time spent in one stage, in microseconds.
+  struct StageTiming {
+    void Add(uint64_t us) {
+      total_us += us;
+      max_us = us > max_us ? us : max_us;
+      count++;
+    }
+
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+    uint64_t count = 0;
+  };
+
+  // Builds, records and submits the next frame, as far as presentation is
+  // not held back by a pending flip or layout change.
+  void DrawScene();
+  // Builds the view list, folds in global damage and sends frame callbacks,
+  // at most once per refresh while nothing is drawn.
+  void SnapshotScene(Frame* frame);
+  // Views of every shown window, bottom to top.
+  CompositorViewList BuildViewList();
+  // Sends frame callbacks to |views| unless they were sent within the last
+  // refresh and |force| is false.
+  void SendFrameCallbacks(const CompositorViewList& views, bool force);
+  // Damages the output where views appeared, went away, moved, were
+  // restacked or changed focus since the last frame.
+  void DamageSceneChanges(const CompositorViewList& views);
+  // Uploads damaged, visible buffer content and updates opaque regions.
+  void UploadTextures(Frame* frame);
+  // Copies subtrees that did not change and decides which views are drawn
+  // from a copy.
+  void UpdateSubtreeCaches(Frame* frame);
+  // Draws the frame into the draw buffer. Returns whether anything was drawn.
+  bool RecordFrame(Frame* frame);
+  // Blits the draw buffer and hands the frame to the backend.
+  void SubmitFrame(bool did_draw, SwitchTiming switch_timing);
+  // Copies the draw buffer, which holds the latest frame, to the pending
+  // copy request.
+  void ServeCopyRequest();
+  // Releases the buffers and signals the release points of frames the GPU
+  // finished.
+  void RetireFrames();
+  // Releases textures of the windows hidden the longest until the textures
+  // of hidden windows fit in the budget.
+  void EvictHiddenTextures();
+
   static Compositor* g_compositor;
   backend::Backend* backend_;
   backend::EglContext* egl_;
@@ -57,6 +191,41 @@ class Compositor {
   std::unique_ptr<CopyRequest> copy_request_;
   Region global_damage_region_ = Region::Empty();
   std::unique_ptr<GlRenderer> renderer_;
+  std::unique_ptr<GpuTimer> gpu_timer_;
+  // What changed on the output in the last frames, so only that is copied
+  // to the back buffer.
+  std::unique_ptr<TileDamage> output_damage_;
+  // Views of the last frame, bottom to top, to find what the scene changed.
+  struct ViewState {
+    wm::Window* window;
+    base::geometry::Rect bounds;
+    bool focused;
+  };
+  std::vector<ViewState> last_views_;
+  std::unique_ptr<WorkspaceThumbnails> thumbnails_;
+  // Copies of window subtrees, by top-level window.
+  std::map<wm::Window*, std::unique_ptr<SubtreeCache>> subtree_caches_;
+  std::map<pid_t, UploadStats> upload_stats_;
+  // Set when a frame was recorded while the previous one was still flipping.
+  bool frame_recorded_ = false;
+  bool recorded_did_draw_ = false;
+  // When frame callbacks were last sent.
+  uint64_t last_callbacks_us_ = 0;
+  StageTiming stage_timings_[kStageCount];
+  // Hidden top-level windows, the one hidden the longest first.
+  std::list<wm::Window*> hidden_windows_;
+  // Start of a workspace switch no frame has picked up yet.
+  uint64_t switch_start_us_ = 0;
+  SwitchTiming recorded_switch_timing_;
+  StageTiming switch_latency_;
+  uint64_t switch_bytes_uploaded_ = 0;
+  // Release points of replaced buffers, signaled after the next frame is
+  // finished.
+  std::vector<SyncPoint> release_points_;
+  // Buffers to release after the next frame, and submitted frames still
+  // holding buffers, oldest first.
+  std::vector<Buffer*> release_buffers_;
+  std::deque<RetiringFrame> retiring_frames_;
 };
 
 }  // namespace compositor
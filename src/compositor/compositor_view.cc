@@ -43,7 +43,10 @@ CompositorView::CompositorView(wm::Window* window,
       damaged_region_(window->window_impl()->DamagedRegion().Clone()),
       global_bounds_(window->geometry() * window->window_impl()->GetScale()),
       global_region_(
-          Region(window->geometry() * window->window_impl()->GetScale())) {
+          Region(window->geometry() * window->window_impl()->GetScale())),
+      viewport_(window->window_impl()->GetViewport()) {
+  // Damage comes in buffer coordinates.
+  damaged_region_ = viewport_.BufferToView(damaged_region_, false);
   damaged_region_.Intersect(window->GetToDrawRegion() *
                             window->window_impl()->GetScale());
   damaged_region_.TranslateInPlace(x_offset + global_bounds_.x(),
@@ -51,14 +54,16 @@ CompositorView::CompositorView(wm::Window* window,
   global_bounds_.x_ += x_offset;
   global_bounds_.y_ += y_offset;
   global_region_.TranslateInPlace(x_offset, y_offset);
-  if (!window->parent()) {
-    auto rect = base::geometry::Rect(
-        global_bounds_.x() + 1, global_bounds_.y() + 1,
-        global_bounds_.width() - 2, global_bounds_.height() - 2);
-    Region inner(rect);
-    border_region_ = global_region_.Clone();
-    border_region_.Subtract(inner);
-  }
+  draw_region_ =
+      Region(window->GetToDrawRegion() * window->window_impl()->GetScale());
+  draw_region_.TranslateInPlace(global_bounds_.x(), global_bounds_.y());
+  draw_region_.Intersect(global_region_);
+}
+
+void CompositorView::SetOpaqueRegion(Region region) {
+  region.TranslateInPlace(global_bounds_.x(), global_bounds_.y());
+  region.Intersect(draw_region_);
+  opaque_region_ = region;
 }
 
 }  // namespace compositor
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "base/geometry.h"
+#include "compositor/buffer_viewport.h"
 #include "compositor/region.h"
 #include "wm/window.h"
 
@@ -27,16 +28,31 @@ class CompositorView {
 
   base::geometry::Rect& global_bounds() { return global_bounds_; }
   Region& global_region() { return global_region_; }
-  Region& border_region() { return border_region_; }
   Region& damaged_region() { return damaged_region_; }
+  Region& opaque_region() { return opaque_region_; }
+  // The part of the view its window wants drawn, excluding e.g. client-side
+  // shadows outside the window geometry.
+  Region& draw_region() { return draw_region_; }
+  // The part of |draw_region_| that is on screen and not covered by opaque
+  // views above.
+  Region& visible_region() { return visible_region_; }
   wm::Window* window() { return window_; }
+  // How the buffer of the window is cropped and scaled onto the view.
+  BufferViewport& viewport() { return viewport_; }
+
+  // Sets the opaque part of the view from |region| in view coordinates,
+  // relative to the view.
+  void SetOpaqueRegion(Region region);
 
  private:
   wm::Window* window_;
   base::geometry::Rect global_bounds_;
   Region global_region_;
   Region damaged_region_;
-  Region border_region_ = Region::Empty();
+  Region opaque_region_ = Region::Empty();
+  Region draw_region_ = Region::Empty();
+  Region visible_region_ = Region::Empty();
+  BufferViewport viewport_;
 };
 
 }  // namespace compositor
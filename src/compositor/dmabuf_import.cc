@@ -0,0 +1,72 @@
+#include "compositor/dmabuf_import.h"
+
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace naive {
+namespace compositor {
+
+DmaBufImporter::DmaBufImporter() {
+  display_ = eglGetCurrentDisplay();
+  const char* egl_extensions =
+      display_ != EGL_NO_DISPLAY ? eglQueryString(display_, EGL_EXTENSIONS)
+                                 : nullptr;
+  const char* gl_extensions =
+      reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (!egl_extensions || !gl_extensions ||
+      !strstr(egl_extensions, "EGL_EXT_image_dma_buf_import") ||
+      !strstr(gl_extensions, "GL_OES_EGL_image")) {
+    LOG_INFO << "dmabuf import unavailable, shm buffers are copied"
+             << std::endl;
+    return;
+  }
+  create_image_ = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(
+      eglGetProcAddress("eglCreateImageKHR"));
+  destroy_image_ = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(
+      eglGetProcAddress("eglDestroyImageKHR"));
+  image_target_texture_ =
+      reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(
+          eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+  supported_ = create_image_ && destroy_image_ && image_target_texture_;
+}
+
+EGLImageKHR DmaBufImporter::Import(int fd,
+                                   uint32_t offset,
+                                   int32_t stride,
+                                   int32_t width,
+                                   int32_t height,
+                                   uint32_t drm_format) {
+  if (!supported_)
+    return EGL_NO_IMAGE_KHR;
+  EGLint attributes[] = {EGL_WIDTH,
+                         width,
+                         EGL_HEIGHT,
+                         height,
+                         EGL_LINUX_DRM_FOURCC_EXT,
+                         static_cast<EGLint>(drm_format),
+                         EGL_DMA_BUF_PLANE0_FD_EXT,
+                         fd,
+                         EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+                         static_cast<EGLint>(offset),
+                         EGL_DMA_BUF_PLANE0_PITCH_EXT,
+                         stride,
+                         EGL_NONE};
+  EGLImageKHR image = create_image_(display_, EGL_NO_CONTEXT,
+                                    EGL_LINUX_DMA_BUF_EXT, nullptr, attributes);
+  if (image == EGL_NO_IMAGE_KHR)
+    TRACE("dmabuf import failed: 0x%x", eglGetError());
+  return image;
+}
+
+void DmaBufImporter::BindToTexture(EGLImageKHR image) {
+  image_target_texture_(GL_TEXTURE_2D, static_cast<GLeglImageOES>(image));
+}
+
+void DmaBufImporter::Release(EGLImageKHR image) {
+  if (image != EGL_NO_IMAGE_KHR)
+    destroy_image_(display_, image);
+}
+
+}  // namespace compositor
+}  // namespace naive
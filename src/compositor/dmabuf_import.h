@@ -0,0 +1,45 @@
+#ifndef COMPOSITOR_DMABUF_IMPORT_H_
+#define COMPOSITOR_DMABUF_IMPORT_H_
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <cstdint>
+
+namespace naive {
+namespace compositor {
+
+// Imports single plane dmabufs as EGLImages and binds them to GL textures, so
+// the GPU samples the memory where it is instead of a copy. Needs
+// EGL_EXT_image_dma_buf_import and GL_OES_EGL_image.
+class DmaBufImporter {
+ public:
+  DmaBufImporter();
+
+  bool supported() { return supported_; }
+
+  // Imports the buffer at |offset| in the dmabuf |fd|. |drm_format| is a DRM
+  // fourcc code. Returns EGL_NO_IMAGE_KHR if the driver refuses it.
+  EGLImageKHR Import(int fd,
+                     uint32_t offset,
+                     int32_t stride,
+                     int32_t width,
+                     int32_t height,
+                     uint32_t drm_format);
+  // Makes |image| the content of the texture bound to GL_TEXTURE_2D.
+  void BindToTexture(EGLImageKHR image);
+  void Release(EGLImageKHR image);
+
+ private:
+  bool supported_ = false;
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  PFNEGLCREATEIMAGEKHRPROC create_image_ = nullptr;
+  PFNEGLDESTROYIMAGEKHRPROC destroy_image_ = nullptr;
+  PFNGLEGLIMAGETARGETTEXTURE2DOESPROC image_target_texture_ = nullptr;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_DMABUF_IMPORT_H_
@@ -13,7 +13,11 @@ DrawQuad::DrawQuad(Buffer* buffer)
       data_(buffer->data()),
       format_(buffer->format()),
       stride_(buffer->stride()),
-      has_data_(true) {}
+      has_data_(true),
+      offset_(buffer->offset()) {
+  if (!buffer->GetDmaBuf(&dmabuf_fd_, &dmabuf_id_))
+    dmabuf_fd_ = -1;
+}
 
 DrawQuad::DrawQuad(int32_t width, int32_t height, void* data)
     : width_(width),
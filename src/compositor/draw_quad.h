@@ -21,11 +21,19 @@ class DrawQuad {
   int32_t format() { return format_; }
   int32_t stride() { return stride_; }
   void* data() { return data_; }
+  int32_t offset() { return offset_; }
+  // The dmabuf holding the buffer, -1 if it can only be copied from. The id
+  // tells different dmabufs apart even when fds are reused.
+  int dmabuf_fd() { return dmabuf_fd_; }
+  uint32_t dmabuf_id() { return dmabuf_id_; }
 
  private:
   bool has_data_{false};
   int32_t format_, width_, height_, stride_;
   void* data_;
+  int32_t offset_ = 0;
+  int dmabuf_fd_ = -1;
+  uint32_t dmabuf_id_ = 0;
 };
 
 }  // namespace compositor
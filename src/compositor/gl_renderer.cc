@@ -2,10 +2,13 @@
 
 #include <GLES3/gl3.h>
 #include <GLES3/gl3ext.h>
+#include <algorithm>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
-#include <vector>
 
 #include "base/logging.h"
+#include "compositor/dmabuf_import.h"
+#include "compositor/program_cache.h"
 
 namespace naive {
 namespace compositor {
@@ -17,123 +20,157 @@ const GLchar* kVertexQuadShader =
     "layout(location = 0) in vec3 vertexPosition_modelspace;\n"
     "layout(location = 1) in vec2 vertexUV;\n"
     "out vec2 UV;\n"
+    "out highp vec2 position;\n"
     "uniform mat4 MVP;\n"
+    "uniform float depth;\n"
     "void main() {\n"
     "  gl_Position = MVP * vec4(vertexPosition_modelspace, 1);\n"
+    "  gl_Position.z = depth;\n"
+    "  position = vertexPosition_modelspace.xy;\n"
     "  UV = vertexUV;\n"
     "}\n";
 
+// Colors fragments within border_width of the edges of border_rect, given as
+// (left, top, right, bottom) in the coordinates quads are drawn in. Fragments
+// outside border_rect, such as popups of a subtree drawn from its copy, are
+// left alone.
+#define BORDER_SHADER_SOURCE                                         \
+  "in highp vec2 position;\n"                                        \
+  "uniform highp vec4 border_rect;\n"                                \
+  "uniform highp float border_width;\n"                              \
+  "uniform vec4 border_color;\n"                                     \
+  "vec4 apply_border(vec4 color) {\n"                                \
+  "  highp vec2 inner = min(position - border_rect.xy,\n"            \
+  "                         border_rect.zw - position);\n"           \
+  "  highp float edge = min(inner.x, inner.y);\n"                    \
+  "  return edge >= 0.0 && edge < border_width ? border_color\n"     \
+  "                                            : color;\n"           \
+  "}\n"
+
 const GLchar* kFragmentQuadShader =
     "#version 320 es\n"
     "precision mediump float;\n"
     "in vec2 UV;\n"
     "out vec4 color;\n"
+    BORDER_SHADER_SOURCE
+    "uniform sampler2D myTextureSampler;\n"
+    "void main() {\n"
+    "  color = apply_border(texture(myTextureSampler, UV).bgra);\n"
+    "}\n";
+
+const GLchar* kFragmentRgbaQuadShader =
+    "#version 320 es\n"
+    "precision mediump float;\n"
+    "in vec2 UV;\n"
+    "out vec4 color;\n"
+    BORDER_SHADER_SOURCE
     "uniform sampler2D myTextureSampler;\n"
     "void main() {\n"
-    "  color = texture(myTextureSampler, UV).bgra;\n"
+    "  color = apply_border(texture(myTextureSampler, UV));\n"
+    "}\n";
+
+// Converts limited range BT.601 YUV, the usual for video, to RGB. The YUV
+// format is given as the value of YuvFormat.
+const GLchar* kFragmentYuvQuadShader =
+    "#version 320 es\n"
+    "precision mediump float;\n"
+    "in highp vec2 UV;\n"
+    "out vec4 color;\n"
+    BORDER_SHADER_SOURCE
+    "uniform sampler2D plane0;\n"
+    "uniform sampler2D plane1;\n"
+    "uniform sampler2D plane2;\n"
+    "uniform int yuv_format;\n"
+    "const mat3 kBt601 = mat3(1.164, 1.164, 1.164,\n"
+    "                         0.0, -0.392, 2.017,\n"
+    "                         1.596, -0.813, 0.0);\n"
+    "void main() {\n"
+    "  vec3 yuv;\n"
+    "  if (yuv_format == 1) {\n"
+    "    yuv = vec3(texture(plane0, UV).r, texture(plane1, UV).rg);\n"
+    "  } else if (yuv_format == 2) {\n"
+    "    vec4 texel = texture(plane0, UV);\n"
+    "    highp float x = UV.x * float(textureSize(plane0, 0).x) * 2.0;\n"
+    "    float luma = mod(floor(x), 2.0) < 1.0 ? texel.r : texel.b;\n"
+    "    yuv = vec3(luma, texel.g, texel.a);\n"
+    "  } else {\n"
+    "    yuv = vec3(texture(plane0, UV).r, texture(plane1, UV).r,\n"
+    "               texture(plane2, UV).r);\n"
+    "  }\n"
+    "  yuv -= vec3(0.0625, 0.5, 0.5);\n"
+    "  color = apply_border(vec4(kBt601 * yuv, 1.0));\n"
     "}\n";
 
 const GLchar* kSolidQuadVertexShader =
     "#version 320 es\n"
     "layout(location = 0) in vec3 vertexPosition_modelspace;\n"
+    "out highp vec2 position;\n"
     "uniform mat4 MVP;\n"
+    "uniform float depth;\n"
     "void main() {\n"
     "  gl_Position = MVP * vec4(vertexPosition_modelspace, 1);\n"
+    "  gl_Position.z = depth;\n"
+    "  position = vertexPosition_modelspace.xy;\n"
     "}\n";
 
 const GLchar* kSolidQuadFragmentShader =
     "#version 320 es\n"
     "precision mediump float;\n"
     "out vec4 color;\n"
+    BORDER_SHADER_SOURCE
     "uniform vec4 fill_color;\n"
     "void main() {\n"
-    "  color = fill_color;\n"
+    "  color = apply_border(fill_color);\n"
     "}\n";
 
-GLuint MakeShaders(const char* vertex, const char* fragment) {
-  GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-  GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-
-  GLint result = GL_FALSE;
-  int info_log_length;
-
-  LOG_INFO << "Compiling vertex shader.";
-  glShaderSource(vertex_shader_id, 1, &vertex, nullptr);
-  glCompileShader(vertex_shader_id);
-
-  glGetShaderiv(vertex_shader_id, GL_COMPILE_STATUS, &result);
-  glGetShaderiv(vertex_shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
-
-  if (info_log_length > 0) {
-    // TODO: should probably use std::string
-    std::vector<char> vertex_shader_error_message(info_log_length + 1);
-    glGetShaderInfoLog(vertex_shader_id, info_log_length, nullptr,
-                       &vertex_shader_error_message[0]);
-    LOG_FATAL << &vertex_shader_error_message[0];
-  }
-
-  LOG_INFO << "Compiling fragment shader.";
-  glShaderSource(fragment_shader_id, 1, &fragment, nullptr);
-  glCompileShader(fragment_shader_id);
-  glGetShaderiv(fragment_shader_id, GL_COMPILE_STATUS, &result);
-  glGetShaderiv(fragment_shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
-
-  if (info_log_length > 0) {
-    // TODO: should probably use std::string
-    std::vector<char> fragment_shader_error_message(info_log_length + 1);
-    glGetShaderInfoLog(fragment_shader_id, info_log_length, nullptr,
-                       &fragment_shader_error_message[0]);
-    LOG_FATAL << &fragment_shader_error_message[0];
-  }
-
-  LOG_INFO << "Linking shader";
-  GLuint program_id = glCreateProgram();
-  glAttachShader(program_id, vertex_shader_id);
-  glAttachShader(program_id, fragment_shader_id);
-  glLinkProgram(program_id);
-
-  glGetProgramiv(program_id, GL_LINK_STATUS, &result);
-  glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
-
-  if (info_log_length > 0) {
-    std::vector<char> program_error_message(info_log_length + 1);
-    glGetProgramInfoLog(program_id, info_log_length, nullptr,
-                        &program_error_message[0]);
-    LOG_FATAL << &program_error_message[0];
-  }
-  glDetachShader(program_id, vertex_shader_id);
-  glDetachShader(program_id, fragment_shader_id);
-
-  glDeleteShader(vertex_shader_id);
-  glDeleteShader(fragment_shader_id);
-
-  return program_id;
-}
-
 }  // namespace
 
 GlRenderer::GlRenderer(int32_t width, int32_t height)
     : screen_width_(width), screen_height_(height) {
-  shader_program_ = MakeShaders(kVertexQuadShader, kFragmentQuadShader);
-  matrix_id_ = glGetUniformLocation(shader_program_, "MVP");
-  texture_id_ = glGetUniformLocation(shader_program_, "myTextureSampler");
+  const char* extensions =
+      reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  bgra_textures_ =
+      extensions && strstr(extensions, "GL_EXT_texture_format_BGRA8888");
+  dmabuf_importer_ = std::make_unique<DmaBufImporter>();
 
-  solid_shader_program_ =
-      MakeShaders(kSolidQuadVertexShader, kSolidQuadFragmentShader);
-  solid_mvp_ = glGetUniformLocation(solid_shader_program_, "MVP");
-  fill_color_ = glGetUniformLocation(solid_shader_program_, "fill_color");
+  // Programs are finished on first use, so their compilation overlaps with
+  // the rest of startup.
+  program_cache_ = std::make_unique<ProgramCache>();
+  texture_program_.id =
+      program_cache_->Build(kVertexQuadShader, kFragmentQuadShader);
+  rgba_program_.id =
+      program_cache_->Build(kVertexQuadShader, kFragmentRgbaQuadShader);
+  solid_program_.id =
+      program_cache_->Build(kSolidQuadVertexShader, kSolidQuadFragmentShader);
+  yuv_program_.id =
+      program_cache_->Build(kVertexQuadShader, kFragmentYuvQuadShader);
 
-  glm::mat4 projection =
-      glm::ortho(0.0f, (float)width, (float)height, 0.0f, 0.1f, 100.0f);
-  glm::mat4 view =
-      glm::lookAt(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
-  glm::mat4 model = glm::mat4(1.0f);
-  mvp_ = projection * view * model;
+  SetProjection(0, 0, width, height);
 
+  // The vertex array keeps the attribute layout, so it is set up only once.
   glGenBuffers(1, &vertex_buffer_);
   glGenBuffers(1, &uvbuffer_);
-  glGenVertexArrays(1, &vertex_buffer_);
+  glGenVertexArrays(1, &vertex_array_id_);
   glBindVertexArray(vertex_array_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+  glVertexAttribPointer(0, 2, GL_INT, GL_FALSE, 0, (void*)0);
+  glBindBuffer(GL_ARRAY_BUFFER, uvbuffer_);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+  bound_array_buffer_ = uvbuffer_;
+  // The solid program does not read texture coordinates, so both arrays can
+  // stay enabled.
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glEnable(GL_BLEND);
+  glBlendFuncSeparate(blend_func_[0], blend_func_[1], blend_func_[2],
+                      blend_func_[3]);
+  glDisable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+  glDepthFunc(GL_LESS);
+  glClearDepthf(1.0f);
 }
 
 GlRenderer::~GlRenderer() {
@@ -144,48 +181,243 @@ GlRenderer::~GlRenderer() {
 
 void GlRenderer::DrawTextureQuad(GLint coords[],
                                  GLfloat texture_coords[],
-                                 GLuint texture) {
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
-  glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(GLint), coords, GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, uvbuffer_);
-  glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(GLfloat), texture_coords,
-               GL_STATIC_DRAW);
+                                 GLuint texture,
+                                 bool swizzle) {
+  BindArrayBuffer(vertex_buffer_);
+  Gl(glBufferData, GL_ARRAY_BUFFER, 8 * sizeof(GLint), coords, GL_STREAM_DRAW);
+  BindArrayBuffer(uvbuffer_);
+  Gl(glBufferData, GL_ARRAY_BUFFER, 8 * sizeof(GLfloat), texture_coords,
+     GL_STREAM_DRAW);
+  UseProgram(swizzle ? &texture_program_ : &rgba_program_);
+  BindTexture(texture);
+  Gl(glDrawArrays, GL_TRIANGLE_FAN, 0, 4);
+}
 
-  glUseProgram(shader_program_);
-  glUniformMatrix4fv(matrix_id_, 1, GL_FALSE, &mvp_[0][0]);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glUniform1i(texture_id_, 0);
-  glEnableVertexAttribArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
-  glVertexAttribPointer(0, 2, GL_INT, GL_FALSE, 0, (void*)0);
-  glEnableVertexAttribArray(1);
-  glBindBuffer(GL_ARRAY_BUFFER, uvbuffer_);
-  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
-  glDisableVertexAttribArray(1);
-  glDisableVertexAttribArray(0);
+void GlRenderer::DrawYuvQuad(GLint coords[],
+                             GLfloat texture_coords[],
+                             const GLuint planes[],
+                             YuvFormat format) {
+  BindArrayBuffer(vertex_buffer_);
+  Gl(glBufferData, GL_ARRAY_BUFFER, 8 * sizeof(GLint), coords, GL_STREAM_DRAW);
+  BindArrayBuffer(uvbuffer_);
+  Gl(glBufferData, GL_ARRAY_BUFFER, 8 * sizeof(GLfloat), texture_coords,
+     GL_STREAM_DRAW);
+  UseProgram(&yuv_program_);
+  GLint value = static_cast<GLint>(format);
+  if (yuv_format_value_ != value) {
+    Gl(glUniform1i, yuv_format_, value);
+    yuv_format_value_ = value;
+  }
+  for (int32_t unit = 0; unit < kTextureUnits; unit++) {
+    if (planes[unit])
+      BindTexture(planes[unit], unit);
+  }
+  Gl(glDrawArrays, GL_TRIANGLE_FAN, 0, 4);
 }
 
 void GlRenderer::DrawSolidQuad(GLint* coords,
                                float r,
                                float g,
                                float b,
+                               float a,
                                bool fill) {
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
-  glBufferData(GL_ARRAY_BUFFER, 8 * sizeof(GLint), coords, GL_STATIC_DRAW);
-  glUseProgram(solid_shader_program_);
-  const GLfloat color[] = {r, g, b, 1.0f};
-  glUniform4fv(fill_color_, 1, color);
-  glUniformMatrix4fv(solid_mvp_, 1, GL_FALSE, &mvp_[0][0]);
-  glEnableVertexAttribArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
-  glVertexAttribPointer(0, 2, GL_INT, GL_FALSE, 0, (void*)0);
+  BindArrayBuffer(vertex_buffer_);
+  Gl(glBufferData, GL_ARRAY_BUFFER, 8 * sizeof(GLint), coords, GL_STREAM_DRAW);
+  UseProgram(&solid_program_);
+  const GLfloat color[] = {r, g, b, a};
+  if (!std::equal(color, color + 4, fill_color_value_)) {
+    Gl(glUniform4fv, fill_color_, 1, color);
+    std::copy(color, color + 4, fill_color_value_);
+  }
   if (fill)
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    Gl(glDrawArrays, GL_TRIANGLE_FAN, 0, 4);
   else
-    glDrawArrays(GL_LINE_LOOP, 0, 4);
-  glDisableVertexAttribArray(0);
+    Gl(glDrawArrays, GL_LINE_LOOP, 0, 4);
+}
+
+void GlRenderer::SetProjection(int32_t x,
+                               int32_t y,
+                               int32_t width,
+                               int32_t height) {
+  SetProjection(base::geometry::Rect(x, y, width, height), width, height);
+}
+
+void GlRenderer::SetProjection(const base::geometry::Rect& area,
+                               int32_t target_width,
+                               int32_t target_height) {
+  Gl(glViewport, 0, 0, target_width, target_height);
+  glm::mat4 projection =
+      glm::ortho((float)area.x(), (float)(area.x() + area.width()),
+                 (float)(area.y() + area.height()), (float)area.y(), 0.1f,
+                 100.0f);
+  glm::mat4 view =
+      glm::lookAt(glm::vec3(0, 0, 1), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+  glm::mat4 model = glm::mat4(1.0f);
+  mvp_ = projection * view * model;
+  mvp_serial_++;
+}
+
+void GlRenderer::ResetProjection() {
+  SetProjection(0, 0, screen_width_, screen_height_);
+}
+
+void GlRenderer::SetBlend(bool enabled) {
+  if (blend_ == enabled)
+    return;
+  if (enabled)
+    Gl(glEnable, GL_BLEND);
+  else
+    Gl(glDisable, GL_BLEND);
+  blend_ = enabled;
+}
+
+void GlRenderer::SetBlendFunc(GLenum src_rgb,
+                              GLenum dst_rgb,
+                              GLenum src_alpha,
+                              GLenum dst_alpha) {
+  GLenum func[] = {src_rgb, dst_rgb, src_alpha, dst_alpha};
+  if (std::equal(func, func + 4, blend_func_))
+    return;
+  Gl(glBlendFuncSeparate, src_rgb, dst_rgb, src_alpha, dst_alpha);
+  std::copy(func, func + 4, blend_func_);
+}
+
+void GlRenderer::SetDepthTest(bool enabled, bool write) {
+  if (depth_test_ != enabled) {
+    if (enabled)
+      Gl(glEnable, GL_DEPTH_TEST);
+    else
+      Gl(glDisable, GL_DEPTH_TEST);
+    depth_test_ = enabled;
+  }
+  if (depth_write_ != write) {
+    Gl(glDepthMask, write ? GL_TRUE : GL_FALSE);
+    depth_write_ = write;
+  }
+}
+
+void GlRenderer::ClearDepth() {
+  // The depth mask applies to clears as well.
+  if (!depth_write_) {
+    Gl(glDepthMask, GL_TRUE);
+    depth_write_ = true;
+  }
+  Gl(glClear, GL_DEPTH_BUFFER_BIT);
+}
+
+void GlRenderer::SetBorder(const base::geometry::Rect& bounds,
+                           int32_t width,
+                           float r,
+                           float g,
+                           float b) {
+  if (border_width_ == width && border_color_[0] == r &&
+      border_color_[1] == g && border_color_[2] == b &&
+      border_rect_.x() == bounds.x() && border_rect_.y() == bounds.y() &&
+      border_rect_.width() == bounds.width() &&
+      border_rect_.height() == bounds.height())
+    return;
+  border_rect_ = bounds;
+  border_width_ = width;
+  border_color_[0] = r;
+  border_color_[1] = g;
+  border_color_[2] = b;
+  border_serial_++;
+}
+
+void GlRenderer::ClearBorder() {
+  if (!border_width_)
+    return;
+  border_width_ = 0;
+  border_serial_++;
+}
+
+void GlRenderer::BindTexture(GLuint texture, int32_t unit) {
+  if (bound_textures_[unit] == texture)
+    return;
+  if (active_unit_ != unit) {
+    Gl(glActiveTexture, GL_TEXTURE0 + unit);
+    active_unit_ = unit;
+  }
+  Gl(glBindTexture, GL_TEXTURE_2D, texture);
+  bound_textures_[unit] = texture;
+}
+
+void GlRenderer::DeleteTexture(GLuint* texture) {
+  if (!*texture)
+    return;
+  // GL unbinds a deleted texture, and its name may be handed out again.
+  for (auto& bound : bound_textures_) {
+    if (bound == *texture)
+      bound = 0;
+  }
+  Gl(glDeleteTextures, 1, texture);
+  *texture = 0;
+}
+
+void GlRenderer::BeginFrame() {
+  gl_calls_last_frame_ = gl_calls_;
+  gl_calls_ = 0;
+}
+
+void GlRenderer::FinishProgram(Program* program) {
+  program_cache_->Finish(program->id);
+  auto location = [this, program](const char* name) {
+    return Gl(glGetUniformLocation, program->id, name);
+  };
+  program->mvp = location("MVP");
+  program->depth = location("depth");
+  program->border_rect = location("border_rect");
+  program->border_width = location("border_width");
+  program->border_color = location("border_color");
+  if (program == &solid_program_)
+    fill_color_ = location("fill_color");
+  if (program == &yuv_program_)
+    yuv_format_ = location("yuv_format");
+
+  Gl(glUseProgram, program->id);
+  current_program_ = program->id;
+  // Textures are drawn from unit 0, and further planes from the units after.
+  static const char* kSamplers[] = {"myTextureSampler", "plane0", "plane1",
+                                    "plane2"};
+  static const GLint kUnits[] = {0, 0, 1, 2};
+  for (size_t i = 0; i < sizeof(kUnits) / sizeof(kUnits[0]); i++) {
+    GLint sampler = location(kSamplers[i]);
+    if (sampler >= 0)
+      Gl(glUniform1i, sampler, kUnits[i]);
+  }
+  program->finished = true;
+}
+
+void GlRenderer::UseProgram(Program* program) {
+  if (!program->finished)
+    FinishProgram(program);
+  if (current_program_ != program->id) {
+    Gl(glUseProgram, program->id);
+    current_program_ = program->id;
+  }
+  if (program->mvp_serial != mvp_serial_) {
+    Gl(glUniformMatrix4fv, program->mvp, 1, GL_FALSE, &mvp_[0][0]);
+    program->mvp_serial = mvp_serial_;
+  }
+  if (program->border_serial != border_serial_) {
+    Gl(glUniform4f, program->border_rect, border_rect_.x(), border_rect_.y(),
+       border_rect_.x() + border_rect_.width(),
+       border_rect_.y() + border_rect_.height());
+    Gl(glUniform1f, program->border_width, border_width_);
+    Gl(glUniform4fv, program->border_color, 1, border_color_);
+    program->border_serial = border_serial_;
+  }
+  if (program->depth_value != depth_) {
+    Gl(glUniform1f, program->depth, depth_);
+    program->depth_value = depth_;
+  }
+}
+
+void GlRenderer::BindArrayBuffer(GLuint buffer) {
+  if (bound_array_buffer_ == buffer)
+    return;
+  Gl(glBindBuffer, GL_ARRAY_BUFFER, buffer);
+  bound_array_buffer_ = buffer;
 }
 
 }  // namespace compositor
@@ -2,35 +2,164 @@
 #define COMPOSITOR_GL_RENDERER_H_
 
 #include "compositor/compositor_view.h"
+#include "compositor/shm_format.h"
 
 #include <GLES3/gl3.h>
 #include <cstdint>
 #include <glm/glm.hpp>
+#include <memory>
+#include <utility>
 
 namespace naive {
 namespace compositor {
 
+class DmaBufImporter;
+class ProgramCache;
+
+// Draws quads for the compositor. GL state set through the renderer is cached,
+// and calls that would not change it are skipped.
 class GlRenderer {
  public:
   explicit GlRenderer(int32_t width, int32_t height);
   ~GlRenderer();
 
+  // Draws |texture| over |coords|. Client buffers hold BGRA pixels and are
+  // swizzled; textures rendered by the compositor itself are not.
   void DrawTextureQuad(GLint coords[],
                        GLfloat texture_coords[],
-                       GLuint texture);
-  void DrawSolidQuad(GLint* coords, float r, float g, float b, bool fill);
+                       GLuint texture,
+                       bool swizzle = true);
+  // Draws YUV content held in |planes|, one texture per plane of |format|.
+  void DrawYuvQuad(GLint coords[],
+                   GLfloat texture_coords[],
+                   const GLuint planes[],
+                   YuvFormat format);
+  void DrawSolidQuad(GLint* coords,
+                     float r,
+                     float g,
+                     float b,
+                     float a,
+                     bool fill);
+
+  // Maps the global rectangle (x, y, width, height) onto the whole of the
+  // bound frame buffer, for drawing into offscreen buffers.
+  void SetProjection(int32_t x, int32_t y, int32_t width, int32_t height);
+  // Same as above, for a frame buffer of a different size than |area|, which
+  // is then scaled to fit.
+  void SetProjection(const base::geometry::Rect& area,
+                     int32_t target_width,
+                     int32_t target_height);
+  // Maps global coordinates onto the screen again.
+  void ResetProjection();
+
+  // Cached GL state. Code drawing through the renderer must change blending
+  // and texture bindings with these instead of calling GL directly.
+  void SetBlend(bool enabled);
+  void SetBlendFunc(GLenum src_rgb,
+                    GLenum dst_rgb,
+                    GLenum src_alpha,
+                    GLenum dst_alpha);
+  void SetBlendFunc(GLenum src, GLenum dst) {
+    SetBlendFunc(src, dst, src, dst);
+  }
+  void BindTexture(GLuint texture, int32_t unit = 0);
+  void DeleteTexture(GLuint* texture);
+
+  // Depth testing, for drawing into the draw buffer only; offscreen buffers
+  // have no depth attachment. Nearer quads have a smaller |depth|, in
+  // [-1, 1]. Quads are drawn at the depth last set.
+  void SetDepthTest(bool enabled, bool write);
+  void SetDepth(float depth) { depth_ = depth; }
+  void ClearDepth();
+
+  // Draws a border of |width| pixels along the inside of |bounds| in place of
+  // whatever quads drawn from now on cover there, until cleared.
+  void SetBorder(const base::geometry::Rect& bounds,
+                 int32_t width,
+                 float r,
+                 float g,
+                 float b);
+  void ClearBorder();
+
+  // Whether textures can hold BGRA pixels through
+  // GL_EXT_texture_format_BGRA8888, so client buffers need no swizzle.
+  bool bgra_textures() { return bgra_textures_; }
+  // Imports client dmabufs so they are drawn without a copy.
+  DmaBufImporter* dmabuf_importer() { return dmabuf_importer_.get(); }
+
+  // Starts counting GL calls for a new frame.
+  void BeginFrame();
+  // GL calls the renderer issued during the last frame.
+  uint32_t gl_calls_last_frame() { return gl_calls_last_frame_; }
 
  private:
+  struct Program {
+    GLuint id = 0;
+    // Whether the program was linked and its uniforms looked up.
+    bool finished = false;
+    GLint mvp = -1;
+    // Projection the MVP uniform was last set to.
+    uint32_t mvp_serial = 0;
+    GLint depth = -1;
+    float depth_value = 0.0f;
+    GLint border_rect = -1;
+    GLint border_width = -1;
+    GLint border_color = -1;
+    // Border the uniforms were last set to.
+    uint32_t border_serial = 0;
+  };
+
+  // Issues the GL call |function| with |args| and counts it, which all calls
+  // made while drawing go through.
+  template <typename Function, typename... Args>
+  decltype(auto) Gl(Function function, Args&&... args) {
+    gl_calls_++;
+    return function(std::forward<Args>(args)...);
+  }
+
+  void FinishProgram(Program* program);
+  // Makes |program| current and brings its uniforms up to date.
+  void UseProgram(Program* program);
+  void BindArrayBuffer(GLuint buffer);
+
   int32_t screen_width_;
   int32_t screen_height_;
-  GLuint shader_program_;
-  GLuint solid_shader_program_;
+  bool bgra_textures_ = false;
+  std::unique_ptr<ProgramCache> program_cache_;
+  std::unique_ptr<DmaBufImporter> dmabuf_importer_;
+  Program texture_program_;
+  Program rgba_program_;
+  Program solid_program_;
+  Program yuv_program_;
+  GLint fill_color_;
+  GLint yuv_format_ = -1;
+  GLint yuv_format_value_ = -1;
   GLuint vertex_buffer_, uvbuffer_;
   GLuint vertex_array_id_;
 
-  GLint matrix_id_, texture_id_, fill_color_, solid_mvp_;
-
   glm::mat4 mvp_;
+  uint32_t mvp_serial_ = 0;
+  float depth_ = 0.0f;
+  base::geometry::Rect border_rect_;
+  int32_t border_width_ = 0;
+  GLfloat border_color_[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  uint32_t border_serial_ = 0;
+
+  // Current GL state.
+  GLuint current_program_ = 0;
+  static constexpr int32_t kTextureUnits = kMaxShmPlanes;
+  int32_t active_unit_ = 0;
+  GLuint bound_textures_[kTextureUnits] = {};
+  GLuint bound_array_buffer_ = 0;
+  bool blend_ = true;
+  bool depth_test_ = false;
+  bool depth_write_ = true;
+  GLenum blend_func_[4] = {GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA,
+                           GL_ONE_MINUS_SRC_ALPHA};
+  GLfloat fill_color_value_[4] = {-1.0f, -1.0f, -1.0f, -1.0f};
+
+  uint32_t gl_calls_ = 0;
+  uint32_t gl_calls_last_frame_ = 0;
 };
 
 }  // namespace compositor
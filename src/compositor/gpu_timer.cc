@@ -0,0 +1,171 @@
+#include "compositor/gpu_timer.h"
+
+#include <EGL/egl.h>
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.h"
+
+namespace naive {
+namespace compositor {
+
+constexpr size_t GpuTimeHistogram::kWindow;
+constexpr size_t GpuTimeHistogram::kBuckets;
+
+void GpuTimeHistogram::Add(uint64_t ns) {
+  if (samples_.size() < kWindow) {
+    samples_.push_back(ns);
+  } else {
+    buckets_[BucketOf(samples_[next_])]--;
+    samples_[next_] = ns;
+    next_ = (next_ + 1) % kWindow;
+  }
+  buckets_[BucketOf(ns)]++;
+}
+
+// static
+uint64_t GpuTimeHistogram::BucketLimitUs(size_t bucket) {
+  if (bucket + 1 >= kBuckets)
+    return 0;
+  return 16ull << bucket;
+}
+
+uint64_t GpuTimeHistogram::average_ns() const {
+  if (samples_.empty())
+    return 0;
+  uint64_t total = 0;
+  for (auto sample : samples_)
+    total += sample;
+  return total / samples_.size();
+}
+
+uint64_t GpuTimeHistogram::max_ns() const {
+  uint64_t result = 0;
+  for (auto sample : samples_)
+    result = std::max(result, sample);
+  return result;
+}
+
+// static
+size_t GpuTimeHistogram::BucketOf(uint64_t ns) {
+  uint64_t us = ns / 1000;
+  size_t bucket = 0;
+  while (bucket + 1 < kBuckets && us >= BucketLimitUs(bucket))
+    bucket++;
+  return bucket;
+}
+
+GpuTimer::GpuTimer() {
+  const char* extensions =
+      reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (!extensions || !strstr(extensions, "GL_EXT_disjoint_timer_query")) {
+    LOG_INFO << "GL_EXT_disjoint_timer_query missing, GPU timing disabled"
+             << std::endl;
+    return;
+  }
+  query_counter_ = reinterpret_cast<PFNGLQUERYCOUNTEREXTPROC>(
+      eglGetProcAddress("glQueryCounterEXT"));
+  get_query_object_ui64v_ = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(
+      eglGetProcAddress("glGetQueryObjectui64vEXT"));
+  if (!query_counter_ || !get_query_object_ui64v_)
+    return;
+
+  for (auto& frame : frames_) {
+    glGenQueries(kPhaseCount, frame.begin);
+    glGenQueries(kPhaseCount, frame.end);
+  }
+  // Clears the disjoint flag set by anything before us.
+  GLint disjoint;
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  supported_ = true;
+}
+
+GpuTimer::~GpuTimer() {
+  if (!supported_)
+    return;
+  for (auto& frame : frames_) {
+    glDeleteQueries(kPhaseCount, frame.begin);
+    glDeleteQueries(kPhaseCount, frame.end);
+  }
+}
+
+void GpuTimer::BeginFrame() {
+  if (!supported_)
+    return;
+  Collect();
+  auto& frame = frames_[current_];
+  if (frame.pending) {
+    // Still not available after kFrameSlots frames; give up on it.
+    frame.pending = false;
+    oldest_ = (oldest_ + 1) % kFrameSlots;
+  }
+  std::fill(frame.measured, frame.measured + kPhaseCount, false);
+  in_frame_ = true;
+}
+
+void GpuTimer::Begin(Phase phase) {
+  if (!in_frame_)
+    return;
+  query_counter_(frames_[current_].begin[phase], GL_TIMESTAMP_EXT);
+}
+
+void GpuTimer::End(Phase phase) {
+  if (!in_frame_)
+    return;
+  query_counter_(frames_[current_].end[phase], GL_TIMESTAMP_EXT);
+  frames_[current_].measured[phase] = true;
+}
+
+void GpuTimer::EndFrame() {
+  if (!in_frame_)
+    return;
+  in_frame_ = false;
+  frames_[current_].pending = true;
+  current_ = (current_ + 1) % kFrameSlots;
+}
+
+void GpuTimer::Collect() {
+  GLint disjoint = 0;
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+  while (frames_[oldest_].pending) {
+    auto& frame = frames_[oldest_];
+    if (disjoint) {
+      // The GPU changed clocks or was reset, so pending timestamps cannot be
+      // compared.
+      frame.pending = false;
+      oldest_ = (oldest_ + 1) % kFrameSlots;
+      continue;
+    }
+    // Timestamps complete in order, so the last one tells for the frame.
+    GLuint last = 0;
+    for (int phase = 0; phase < kPhaseCount; phase++) {
+      if (frame.measured[phase])
+        last = frame.end[phase];
+    }
+    if (last) {
+      GLuint available = GL_FALSE;
+      glGetQueryObjectuiv(last, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+        return;
+    }
+
+    uint64_t total = 0;
+    for (int phase = 0; phase < kPhaseCount; phase++) {
+      if (!frame.measured[phase])
+        continue;
+      GLuint64 begin = 0, end = 0;
+      get_query_object_ui64v_(frame.begin[phase], GL_QUERY_RESULT, &begin);
+      get_query_object_ui64v_(frame.end[phase], GL_QUERY_RESULT, &end);
+      uint64_t duration = end > begin ? end - begin : 0;
+      histograms_[phase].Add(duration);
+      total += duration;
+    }
+    if (last)
+      frame_histogram_.Add(total);
+    frame.pending = false;
+    oldest_ = (oldest_ + 1) % kFrameSlots;
+  }
+}
+
+}  // namespace compositor
+}  // namespace naive
@@ -0,0 +1,99 @@
+#ifndef COMPOSITOR_GPU_TIMER_H_
+#define COMPOSITOR_GPU_TIMER_H_
+
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace naive {
+namespace compositor {
+
+// Distribution of the last kWindow samples, in power of two buckets of
+// microseconds: bucket 0 counts samples under 16 us, bucket i samples in
+// [2^(i+3), 2^(i+4)) us, and the last bucket everything longer.
+class GpuTimeHistogram {
+ public:
+  static constexpr size_t kWindow = 512;
+  static constexpr size_t kBuckets = 12;
+
+  void Add(uint64_t ns);
+  const uint32_t* buckets() const { return buckets_; }
+  // Upper bound of |bucket| in microseconds, 0 for the last one.
+  static uint64_t BucketLimitUs(size_t bucket);
+  uint32_t count() const { return samples_.size(); }
+  uint64_t average_ns() const;
+  uint64_t max_ns() const;
+
+ private:
+  static size_t BucketOf(uint64_t ns);
+
+  std::vector<uint64_t> samples_;
+  // Where the next sample goes once the window is full.
+  size_t next_ = 0;
+  uint32_t buckets_[kBuckets] = {};
+};
+
+// Measures how long the GPU spends in each phase of a frame through
+// GL_EXT_disjoint_timer_query timestamps. Results are read back a few frames
+// later, once available, so measuring never waits for the GPU. Where the
+// extension is missing, all of this does nothing.
+class GpuTimer {
+ public:
+  enum Phase {
+    kPhaseUpload,
+    kPhaseComposite,
+    kPhaseBlit,
+    kPhaseCount,
+  };
+
+  GpuTimer();
+  ~GpuTimer();
+
+  bool supported() const { return supported_; }
+
+  // Frames are measured one at a time, from BeginFrame() to EndFrame().
+  void BeginFrame();
+  void Begin(Phase phase);
+  void End(Phase phase);
+  void EndFrame();
+
+  const GpuTimeHistogram& histogram(Phase phase) const {
+    return histograms_[phase];
+  }
+  // Sum of the phases of each frame.
+  const GpuTimeHistogram& frame_histogram() const { return frame_histogram_; }
+
+ private:
+  // Frames whose timestamps may be in flight at once. A frame whose results
+  // are still not available when its slot comes round again is dropped.
+  static constexpr size_t kFrameSlots = 4;
+
+  struct FrameQueries {
+    GLuint begin[kPhaseCount];
+    GLuint end[kPhaseCount];
+    // Phases that have both timestamps queued.
+    bool measured[kPhaseCount];
+    bool pending = false;
+  };
+
+  // Reads back frames whose results are available, oldest first.
+  void Collect();
+
+  bool supported_ = false;
+  PFNGLQUERYCOUNTEREXTPROC query_counter_ = nullptr;
+  PFNGLGETQUERYOBJECTUI64VEXTPROC get_query_object_ui64v_ = nullptr;
+  FrameQueries frames_[kFrameSlots];
+  // Slot of the frame being measured, and of the oldest pending frame.
+  size_t current_ = 0;
+  size_t oldest_ = 0;
+  bool in_frame_ = false;
+  GpuTimeHistogram histograms_[kPhaseCount];
+  GpuTimeHistogram frame_histogram_;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_GPU_TIMER_H_
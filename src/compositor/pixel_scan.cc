@@ -0,0 +1,141 @@
+#include "compositor/pixel_scan.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <vector>
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+bool RowMatchesColor(const uint32_t* row, int32_t width, uint32_t color) {
+  int32_t i = 0;
+#if defined(__SSE2__)
+  const __m128i expected = _mm_set1_epi32(static_cast<int32_t>(color));
+  for (; i + 16 <= width; i += 16) {
+    __m128i a = _mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)), expected);
+    __m128i b = _mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 4)),
+        expected);
+    __m128i c = _mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 8)),
+        expected);
+    __m128i d = _mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 12)),
+        expected);
+    __m128i all = _mm_and_si128(_mm_and_si128(a, b), _mm_and_si128(c, d));
+    if (_mm_movemask_epi8(all) != 0xffff)
+      return false;
+  }
+  for (; i + 4 <= width; i += 4) {
+    __m128i a = _mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)), expected);
+    if (_mm_movemask_epi8(a) != 0xffff)
+      return false;
+  }
+#endif
+  for (; i < width; i++) {
+    if (row[i] != color)
+      return false;
+  }
+  return true;
+}
+
+constexpr uint32_t kAlphaMask = 0xff000000;
+
+// ANDs |width| pixels of |row| into |accumulated|.
+void AndRow(uint32_t* accumulated, const uint32_t* row, int32_t width) {
+  int32_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 4 <= width; i += 4) {
+    __m128i* out = reinterpret_cast<__m128i*>(accumulated + i);
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    _mm_storeu_si128(out, _mm_and_si128(_mm_loadu_si128(out), in));
+  }
+#endif
+  for (; i < width; i++)
+    accumulated[i] &= row[i];
+}
+
+// Returns the number of consecutive opaque pixels starting at |pixels|.
+int32_t OpaqueRunLength(const uint32_t* pixels, int32_t width) {
+  int32_t i = 0;
+#if defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi32(static_cast<int32_t>(kAlphaMask));
+  for (; i + 4 <= width; i += 4) {
+    __m128i alpha = _mm_and_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i)), mask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, mask)) != 0xffff)
+      break;
+  }
+#endif
+  while (i < width && (pixels[i] & kAlphaMask) == kAlphaMask)
+    i++;
+  return i;
+}
+
+}  // namespace
+
+bool MatchesColor(const void* data,
+                  int32_t stride,
+                  const base::geometry::Rect& rect,
+                  uint32_t color) {
+  const uint8_t* pixels = static_cast<const uint8_t*>(data);
+  for (int32_t y = rect.y(); y < rect.y() + rect.height(); y++) {
+    const uint32_t* row =
+        reinterpret_cast<const uint32_t*>(pixels + y * stride) + rect.x();
+    if (!RowMatchesColor(row, rect.width(), color))
+      return false;
+  }
+  return true;
+}
+
+bool FindUniformColor(const void* data,
+                      int32_t stride,
+                      const base::geometry::Rect& rect,
+                      uint32_t* color) {
+  if (rect.width() <= 0 || rect.height() <= 0)
+    return false;
+  const uint8_t* pixels = static_cast<const uint8_t*>(data);
+  uint32_t first = *(reinterpret_cast<const uint32_t*>(
+                         pixels + rect.y() * stride) +
+                     rect.x());
+  if (!MatchesColor(data, stride, rect, first))
+    return false;
+  *color = first;
+  return true;
+}
+
+void FindOpaqueSpan(const void* data,
+                    int32_t stride,
+                    int32_t width,
+                    int32_t rows,
+                    int32_t* start,
+                    int32_t* end) {
+  *start = *end = 0;
+  if (width <= 0 || rows <= 0)
+    return;
+  const uint8_t* pixels = static_cast<const uint8_t*>(data);
+  const uint32_t* first = reinterpret_cast<const uint32_t*>(pixels);
+  std::vector<uint32_t> columns(first, first + width);
+  for (int32_t y = 1; y < rows; y++) {
+    AndRow(columns.data(),
+           reinterpret_cast<const uint32_t*>(pixels + y * stride), width);
+  }
+
+  int32_t x = 0;
+  while (x < width) {
+    int32_t run = OpaqueRunLength(columns.data() + x, width - x);
+    if (run > *end - *start) {
+      *start = x;
+      *end = x + run;
+    }
+    x += run + 1;
+  }
+}
+
+}  // namespace compositor
+}  // namespace naive
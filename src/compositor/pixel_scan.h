@@ -0,0 +1,38 @@
+#ifndef COMPOSITOR_PIXEL_SCAN_H_
+#define COMPOSITOR_PIXEL_SCAN_H_
+
+#include <cstdint>
+
+#include "base/geometry.h"
+
+namespace naive {
+namespace compositor {
+
+// Returns true if every 32-bit pixel of |rect| in the image at |data| with row
+// pitch |stride| equals |color|.
+bool MatchesColor(const void* data,
+                  int32_t stride,
+                  const base::geometry::Rect& rect,
+                  uint32_t color);
+
+// Returns true if |rect| in the image at |data| is one uniform color, which is
+// then stored in |color|.
+bool FindUniformColor(const void* data,
+                      int32_t stride,
+                      const base::geometry::Rect& rect,
+                      uint32_t* color);
+
+// Finds the widest run of columns in [0, |width|) whose pixels are opaque in
+// all |rows| rows at |data|, assuming alpha in the top byte. The run is
+// returned as [*start, *end), which is empty if no pixel is opaque.
+void FindOpaqueSpan(const void* data,
+                    int32_t stride,
+                    int32_t width,
+                    int32_t rows,
+                    int32_t* start,
+                    int32_t* end);
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_PIXEL_SCAN_H_
@@ -0,0 +1,216 @@
+#include "compositor/program_cache.h"
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "base/hash.h"
+#include "base/logging.h"
+#include "config.h"
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+uint32_t HashString(uint32_t crc, const char* string) {
+  if (!string)
+    return crc;
+  // The length keeps consecutive strings from hashing like their
+  // concatenation.
+  uint32_t length = strlen(string);
+  crc = base::Crc32c(crc, &length, sizeof(length));
+  return base::Crc32c(crc, string, length);
+}
+
+std::string CacheDirectory() {
+  if (config::kShaderCacheDir[0])
+    return config::kShaderCacheDir;
+  const char* xdg_cache = getenv("XDG_CACHE_HOME");
+  if (xdg_cache && xdg_cache[0])
+    return std::string(xdg_cache) + "/naive-wm/shaders";
+  const char* home = getenv("HOME");
+  if (home && home[0])
+    return std::string(home) + "/.cache/naive-wm/shaders";
+  return std::string();
+}
+
+bool MakeDirectories(const std::string& path) {
+  for (size_t pos = 1; pos <= path.size(); pos++) {
+    if (pos < path.size() && path[pos] != '/')
+      continue;
+    std::string prefix = path.substr(0, pos);
+    if (mkdir(prefix.c_str(), 0755) && errno != EEXIST)
+      return false;
+  }
+  return true;
+}
+
+// Logs the info log of a shader, and dies if it did not compile.
+void CheckShader(GLuint shader, const char* kind) {
+  GLint result = GL_FALSE;
+  int info_log_length;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+  if (info_log_length > 0) {
+    std::vector<char> message(info_log_length + 1);
+    glGetShaderInfoLog(shader, info_log_length, nullptr, &message[0]);
+    if (result != GL_TRUE)
+      LOG_FATAL << kind << " shader: " << &message[0];
+    LOG_INFO << kind << " shader: " << &message[0];
+  } else if (result != GL_TRUE) {
+    LOG_FATAL << kind << " shader failed to compile";
+  }
+}
+
+}  // namespace
+
+ProgramCache::ProgramCache() : directory_(CacheDirectory()) {
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    driver_hash_ = HashString(
+        driver_hash_, reinterpret_cast<const char*>(glGetString(name)));
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  binaries_supported_ = formats > 0 && !directory_.empty();
+  if (binaries_supported_ && !MakeDirectories(directory_)) {
+    LOG_ERROR << "cannot create shader cache " << directory_ << std::endl;
+    binaries_supported_ = false;
+  }
+}
+
+ProgramCache::~ProgramCache() {
+  for (auto& entry : pending_) {
+    glDeleteShader(entry.second.vertex_shader);
+    glDeleteShader(entry.second.fragment_shader);
+  }
+}
+
+GLuint ProgramCache::Build(const char* vertex, const char* fragment) {
+  std::string path;
+  if (binaries_supported_) {
+    char name[32];
+    snprintf(name, sizeof(name), "/%08x-%08x.bin", driver_hash_,
+             HashString(HashString(0, vertex), fragment));
+    path = directory_ + name;
+    GLuint program = LoadBinary(path);
+    if (program)
+      return program;
+  }
+
+  LOG_INFO << "Compiling shaders.";
+  GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vertex_shader, 1, &vertex, nullptr);
+  glCompileShader(vertex_shader);
+  GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(fragment_shader, 1, &fragment, nullptr);
+  glCompileShader(fragment_shader);
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vertex_shader);
+  glAttachShader(program, fragment_shader);
+  if (binaries_supported_)
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(program);
+  // Statuses are only queried in Finish(), as querying waits for the driver.
+  pending_[program] = {vertex_shader, fragment_shader, path};
+  return program;
+}
+
+void ProgramCache::Finish(GLuint program) {
+  auto iter = pending_.find(program);
+  if (iter == pending_.end())
+    return;
+  PendingProgram pending = iter->second;
+  pending_.erase(iter);
+
+  CheckShader(pending.vertex_shader, "vertex");
+  CheckShader(pending.fragment_shader, "fragment");
+
+  GLint result = GL_FALSE;
+  int info_log_length;
+  glGetProgramiv(program, GL_LINK_STATUS, &result);
+  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+  if (info_log_length > 0) {
+    std::vector<char> program_error_message(info_log_length + 1);
+    glGetProgramInfoLog(program, info_log_length, nullptr,
+                        &program_error_message[0]);
+    if (result != GL_TRUE)
+      LOG_FATAL << &program_error_message[0];
+    LOG_INFO << &program_error_message[0];
+  } else if (result != GL_TRUE) {
+    LOG_FATAL << "shader program failed to link";
+  }
+  glDetachShader(program, pending.vertex_shader);
+  glDetachShader(program, pending.fragment_shader);
+  glDeleteShader(pending.vertex_shader);
+  glDeleteShader(pending.fragment_shader);
+
+  if (!pending.path.empty())
+    StoreBinary(program, pending.path);
+}
+
+GLuint ProgramCache::LoadBinary(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file)
+    return 0;
+  GLenum format;
+  std::vector<uint8_t> binary;
+  bool read = fread(&format, sizeof(format), 1, file) == 1;
+  if (read) {
+    long start = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    fseek(file, start, SEEK_SET);
+    binary.resize(end > start ? end - start : 0);
+    read = !binary.empty() &&
+           fread(binary.data(), 1, binary.size(), file) == binary.size();
+  }
+  fclose(file);
+  if (!read)
+    return 0;
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, format, binary.data(), binary.size());
+  GLint result = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &result);
+  if (result != GL_TRUE) {
+    // Drivers may reject binaries of other builds even with the same
+    // version string.
+    TRACE("stale shader binary %s", path.c_str());
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+void ProgramCache::StoreBinary(GLuint program, const std::string& path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+  std::vector<uint8_t> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  // Written aside and renamed, so another instance never reads half a file.
+  std::string temp_path = path + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (!file) {
+    TRACE("cannot open file %s", temp_path.c_str());
+    return;
+  }
+  bool written = fwrite(&format, sizeof(format), 1, file) == 1 &&
+                 fwrite(binary.data(), 1, length, file) == (size_t)length;
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temp_path.c_str(), path.c_str())) {
+    LOG_ERROR << "cannot write shader binary " << path << std::endl;
+    remove(temp_path.c_str());
+  }
+}
+
+}  // namespace compositor
+}  // namespace naive
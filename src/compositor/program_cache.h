@@ -0,0 +1,53 @@
+#ifndef COMPOSITOR_PROGRAM_CACHE_H_
+#define COMPOSITOR_PROGRAM_CACHE_H_
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace naive {
+namespace compositor {
+
+// Builds shader programs, keeping linked program binaries on disk so later
+// starts load them instead of compiling. Binaries are keyed by the GL vendor,
+// renderer and version strings and the shader sources, so a driver update or
+// a shader change compiles again.
+//
+// Programs built from source are only compiled and linked when first needed:
+// Build() submits every program up front and returns without waiting, so
+// drivers compiling on their own threads work through them while startup goes
+// on, and Finish() blocks on just the program about to be used.
+class ProgramCache {
+ public:
+  ProgramCache();
+  ~ProgramCache();
+
+  // Returns a program made of the |vertex| and |fragment| shaders. It may
+  // still be linking; call Finish() before using it.
+  GLuint Build(const char* vertex, const char* fragment);
+  // Waits for |program| to link and stores its binary. Programs that fail to
+  // compile or link are fatal.
+  void Finish(GLuint program);
+
+ private:
+  struct PendingProgram {
+    GLuint vertex_shader;
+    GLuint fragment_shader;
+    std::string path;
+  };
+
+  GLuint LoadBinary(const std::string& path);
+  void StoreBinary(GLuint program, const std::string& path);
+
+  std::string directory_;
+  // Hash of the driver strings, part of every key.
+  uint32_t driver_hash_ = 0;
+  bool binaries_supported_ = false;
+  std::map<GLuint, PendingProgram> pending_;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_PROGRAM_CACHE_H_
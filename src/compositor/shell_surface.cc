@@ -1,5 +1,8 @@
 #include "compositor/shell_surface.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "compositor/buffer.h"
 #include "compositor/surface.h"
 #include "wm/window_impl.h"
@@ -8,6 +11,13 @@
 
 namespace naive {
 
+namespace {
+
+// Shell surfaces with a configure waiting for FlushConfigures().
+std::vector<ShellSurface*> g_queued_configures;
+
+}  // namespace
+
 ShellSurface::ShellSurface(Surface* surface)
     : surface_(surface), window_(surface->window()) {
   window_->SetShellSurface(this);
@@ -17,6 +27,10 @@ ShellSurface::ShellSurface(Surface* surface)
 
 ShellSurface::~ShellSurface() {
   TRACE("%p", this);
+  if (configure_queued_) {
+    g_queued_configures.erase(std::find(g_queued_configures.begin(),
+                                        g_queued_configures.end(), this));
+  }
   if (window_) {
     static_cast<wm::WindowImplWayland*>(window_->window_impl())
         ->set_shell_surface(nullptr);
@@ -32,8 +46,61 @@ void ShellSurface::Configure(int32_t width, int32_t height) {
   TRACE("configuring: %p, width: %d, height: %d", this, width, height);
   if (!window_ || window_->is_transient())
     return;
-  in_configure_ = true;
-  configure_callback_(width, height);
+  queued_configure_.width = width;
+  queued_configure_.height = height;
+  if (!configure_queued_) {
+    configure_queued_ = true;
+    g_queued_configures.push_back(this);
+  }
+  // Only a new size has to be drawn before a layout change is presented.
+  if (!has_sent_configure_ || width != sent_configure_.width ||
+      height != sent_configure_.height)
+    wm::WindowManager::Get()->layout_transaction()->AddWindow(window_);
+}
+
+// static
+void ShellSurface::FlushConfigures() {
+  auto queued = std::move(g_queued_configures);
+  g_queued_configures.clear();
+  for (auto* shell_surface : queued)
+    shell_surface->SendConfigure();
+}
+
+void ShellSurface::SendConfigure() {
+  configure_queued_ = false;
+  if (!window_)
+    return;
+  auto* transaction = wm::WindowManager::Get()->layout_transaction();
+  // Focus is sent as of now, as it may change after the configure was
+  // queued.
+  queued_configure_.activated = sends_activated_ && window_->focused();
+  // A client that drew for the last configure but at another size ignored
+  // or clamped it, or resized itself, and is told the size again.
+  auto geometry = window_->geometry();
+  bool size_taken = configure_serial_ ||
+                    (geometry.width() == sent_configure_.width &&
+                     geometry.height() == sent_configure_.height);
+  if (has_sent_configure_ && size_taken &&
+      queued_configure_.width == sent_configure_.width &&
+      queued_configure_.height == sent_configure_.height &&
+      queued_configure_.activated == sent_configure_.activated) {
+    TRACE("dropping configure of %p, nothing changed", this);
+    if (!configure_serial_)
+      transaction->OnWindowReady(window_);
+    return;
+  }
+
+  sent_configure_ = queued_configure_;
+  has_sent_configure_ = true;
+  uint32_t serial =
+      configure_callback_(sent_configure_.width, sent_configure_.height);
+  // Configures without a serial, such as wl_shell ones, are never
+  // acknowledged and not waited for.
+  if (!serial) {
+    transaction->OnWindowReady(window_);
+    return;
+  }
+  configure_serial_ = serial;
 }
 
 void ShellSurface::Close() {
@@ -66,9 +133,8 @@ void ShellSurface::Move() {
 }
 
 void ShellSurface::AcknowledgeConfigure(uint32_t serial) {
-  in_configure_ = false;
-  // TODO: need to implement this?
-  NOTIMPLEMENTED();
+  TRACE("%p acked %u, last configure %u", this, serial, configure_serial_);
+  acked_serial_ = serial;
 }
 
 void ShellSurface::OnCommit(Surface* committed_surface) {
@@ -84,6 +150,13 @@ void ShellSurface::OnCommit(Surface* committed_surface) {
   state_ = pending_state_;
   window_->PushProperty(state_.geometry, state_.visible_region);
   window_->MaybeMakeTopLevel();
+
+  // An older serial means the client has not seen the last configure yet.
+  if (configure_serial_ && acked_serial_ == configure_serial_ &&
+      !configure_queued_ && surface_->committed_buffer()) {
+    configure_serial_ = 0;
+    wm::WindowManager::Get()->layout_transaction()->OnWindowReady(window_);
+  }
 }
 
 void ShellSurface::OnSurfaceDestroyed(Surface* surface) {
@@ -52,8 +52,18 @@ class ShellSurface : SurfaceObserver {
   void set_visibility_changed_callback(std::function<void(bool)> callback) {
     visibility_changed_callback_ = callback;
   }
+  // Whether configures tell the client if it has focus, so focus changes
+  // have to be configured.
+  void set_sends_activated(bool sends_activated) {
+    sends_activated_ = sends_activated;
+  }
 
+  // Queues a configure, sent by FlushConfigures() unless it repeats the last
+  // one sent.
   void Configure(int32_t width, int32_t height);
+  // Sends the configures queued since the last call, at most one per shell
+  // surface.
+  static void FlushConfigures();
   void Activate() { activation_callback_(); }
   void Close();
   void Ungrab() {
@@ -85,6 +95,16 @@ class ShellSurface : SurfaceObserver {
   };
   ShellState pending_state_, state_;
 
+  // What a configure tells the client; |activated| is set only for shells
+  // that send it.
+  struct ConfigureState {
+    int32_t width = 0;
+    int32_t height = 0;
+    bool activated = false;
+  };
+
+  void SendConfigure();
+
   std::function<uint32_t(int32_t, int32_t)> configure_callback_;
   std::function<void()> close_callback_;
   std::function<void()> destroy_callback_;
@@ -94,7 +114,14 @@ class ShellSurface : SurfaceObserver {
 
   wm::Window* window_;
   Surface* surface_;
-  bool in_configure_ = false;
+  // Serial of the last configure the window waits to be drawn for, 0 once
+  // a buffer for it was committed, and the last serial acknowledged.
+  uint32_t configure_serial_ = 0;
+  uint32_t acked_serial_ = 0;
+  ConfigureState queued_configure_, sent_configure_;
+  bool configure_queued_ = false;
+  bool has_sent_configure_ = false;
+  bool sends_activated_ = false;
 
   struct CachedWindowState {
     bool has_border_{false};
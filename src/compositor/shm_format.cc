@@ -0,0 +1,115 @@
+#include "compositor/shm_format.h"
+
+#include <GLES2/gl2ext.h>
+#include <wayland-server.h>
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+constexpr ShmPlane kRgbaPlane = {4, 1, 1, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE};
+constexpr ShmPlane kBgraPlane = {4,           1, 1, GL_BGRA_EXT,
+                                 GL_BGRA_EXT, GL_UNSIGNED_BYTE};
+constexpr ShmPlane kRgb565Plane = {2,      1, 1, GL_RGB565,
+                                   GL_RGB, GL_UNSIGNED_SHORT_5_6_5};
+constexpr ShmPlane kLumaPlane = {1, 1, 1, GL_R8, GL_RED, GL_UNSIGNED_BYTE};
+constexpr ShmPlane kChromaPlane = {1, 2, 2, GL_R8, GL_RED, GL_UNSIGNED_BYTE};
+constexpr ShmPlane kChromaPairPlane = {2, 2, 2, GL_RG8, GL_RG,
+                                       GL_UNSIGNED_BYTE};
+// Each RGBA texel holds Y0 U Y1 V of two pixels.
+constexpr ShmPlane kYuyvPlane = {4, 2, 1, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE};
+
+const ShmFormat kFormats[] = {
+    {WL_SHM_FORMAT_ARGB8888, true, true, YuvFormat::kNone, 1, {kRgbaPlane}},
+    {WL_SHM_FORMAT_XRGB8888, false, true, YuvFormat::kNone, 1, {kRgbaPlane}},
+    {WL_SHM_FORMAT_ABGR8888, true, false, YuvFormat::kNone, 1, {kRgbaPlane}},
+    {WL_SHM_FORMAT_XBGR8888, false, false, YuvFormat::kNone, 1, {kRgbaPlane}},
+    {WL_SHM_FORMAT_RGB565, false, false, YuvFormat::kNone, 1, {kRgb565Plane}},
+    {WL_SHM_FORMAT_NV12,
+     false,
+     false,
+     YuvFormat::kNv12,
+     2,
+     {kLumaPlane, kChromaPairPlane}},
+    {WL_SHM_FORMAT_YUYV, false, false, YuvFormat::kYuyv, 1, {kYuyvPlane}},
+    {WL_SHM_FORMAT_YUV420,
+     false,
+     false,
+     YuvFormat::kI420,
+     3,
+     {kLumaPlane, kChromaPlane, kChromaPlane}},
+};
+
+const ShmFormat kBgraFormats[] = {
+    {WL_SHM_FORMAT_ARGB8888, true, true, YuvFormat::kNone, 1, {kBgraPlane}},
+    {WL_SHM_FORMAT_XRGB8888, false, true, YuvFormat::kNone, 1, {kBgraPlane}},
+};
+
+}  // namespace
+
+const ShmFormat* FindShmFormat(uint32_t format, bool bgra_textures) {
+  if (bgra_textures) {
+    for (auto& entry : kBgraFormats) {
+      if (entry.format == format)
+        return &entry;
+    }
+  }
+  for (auto& entry : kFormats) {
+    if (entry.format == format)
+      return &entry;
+  }
+  return nullptr;
+}
+
+std::vector<uint32_t> SupportedShmFormats() {
+  std::vector<uint32_t> result;
+  for (auto& entry : kFormats)
+    result.push_back(entry.format);
+  return result;
+}
+
+size_t ShmPlaneOffset(const ShmFormat& format,
+                      int32_t index,
+                      int32_t stride,
+                      int32_t height,
+                      int32_t* plane_stride) {
+  auto& first = format.planes[0];
+  size_t offset = 0;
+  for (int32_t i = 0;; i++) {
+    auto& plane = format.planes[i];
+    int32_t current = static_cast<int64_t>(stride) * plane.bytes_per_texel *
+                      first.horizontal_subsampling /
+                      (first.bytes_per_texel * plane.horizontal_subsampling);
+    if (i == index) {
+      *plane_stride = current;
+      return offset;
+    }
+    int32_t rows = (height + plane.vertical_subsampling - 1) /
+                   plane.vertical_subsampling;
+    offset += static_cast<size_t>(current) * rows;
+  }
+}
+
+uint32_t DrmFourcc(uint32_t format) {
+  switch (format) {
+    case WL_SHM_FORMAT_ARGB8888:
+      return 0x34325241;  // 'AR24'
+    case WL_SHM_FORMAT_XRGB8888:
+      return 0x34325258;  // 'XR24'
+    default:
+      return format;
+  }
+}
+
+size_t ShmBufferSize(const ShmFormat& format, int32_t stride, int32_t height) {
+  int32_t last = format.plane_count - 1;
+  int32_t plane_stride;
+  size_t offset = ShmPlaneOffset(format, last, stride, height, &plane_stride);
+  int32_t rows = (height + format.planes[last].vertical_subsampling - 1) /
+                 format.planes[last].vertical_subsampling;
+  return offset + static_cast<size_t>(plane_stride) * rows;
+}
+
+}  // namespace compositor
+}  // namespace naive
@@ -0,0 +1,80 @@
+#ifndef COMPOSITOR_SHM_FORMAT_H_
+#define COMPOSITOR_SHM_FORMAT_H_
+
+#include <GLES3/gl3.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace naive {
+namespace compositor {
+
+// How a YUV format is converted to RGB in the shader.
+enum class YuvFormat {
+  kNone,
+  // A Y plane and a plane of interleaved U and V at half resolution.
+  kNv12,
+  // Y0 U Y1 V packed into one plane, each texel covering two pixels.
+  kYuyv,
+  // Y, U and V planes, U and V at half resolution.
+  kI420,
+};
+
+// One plane of a format, uploaded into a texture of its own.
+struct ShmPlane {
+  int32_t bytes_per_texel;
+  // Pixels of the buffer covered by one texel, along each axis.
+  int32_t horizontal_subsampling;
+  int32_t vertical_subsampling;
+  GLint internal_format;
+  GLenum pixel_format;
+  GLenum type;
+};
+
+constexpr int32_t kMaxShmPlanes = 3;
+
+// How pixels of a wl_shm format are uploaded to textures. Formats are taken
+// as they are and converted by the GPU, on upload or in the shader.
+//
+// Planes of multi-planar formats follow each other in the buffer, each with a
+// stride scaled from the buffer's stride like its rows are, which is how
+// clients lay them out in shm.
+struct ShmFormat {
+  uint32_t format;
+  // Whether the alpha channel is used; it is ignored otherwise.
+  bool has_alpha;
+  // Whether 32-bit pixels hold red in bits 16-23 and blue in bits 0-7, which
+  // is BGRA in memory and needs swizzling unless uploaded as BGRA.
+  bool bgra;
+  YuvFormat yuv;
+  int32_t plane_count;
+  ShmPlane planes[kMaxShmPlanes];
+};
+
+// Returns how |format| is uploaded, or nullptr if it is not supported.
+// |bgra_textures| tells whether GL_EXT_texture_format_BGRA8888 is there, so
+// BGRA content is uploaded as such and needs no swizzle.
+const ShmFormat* FindShmFormat(uint32_t format, bool bgra_textures);
+
+// Formats advertised to clients.
+std::vector<uint32_t> SupportedShmFormats();
+
+// Returns where plane |index| of a buffer with |stride| starts, relative to
+// the buffer, and stores its stride in |plane_stride|.
+size_t ShmPlaneOffset(const ShmFormat& format,
+                      int32_t index,
+                      int32_t stride,
+                      int32_t height,
+                      int32_t* plane_stride);
+
+// Returns the DRM fourcc code of a wl_shm format. They are the same except
+// for ARGB8888 and XRGB8888, which wl_shm numbers 0 and 1.
+uint32_t DrmFourcc(uint32_t format);
+
+// Bytes a buffer of the given size takes up.
+size_t ShmBufferSize(const ShmFormat& format, int32_t stride, int32_t height);
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_SHM_FORMAT_H_
@@ -7,13 +7,20 @@ namespace naive {
 SubSurface::SubSurface(Surface* parent, Surface* surface)
     : parent_(parent), surface_(surface) {
   TRACE("%p, parent: %p, child: %p", this, parent, surface);
-  // TODO: Observe child surface as well!
   parent_->window()->AddChild(surface->window());
   parent_->AddSurfaceObserver(this);
+  surface_->AddSurfaceObserver(this);
+  surface_->set_sub_surface(this);
 }
 
 SubSurface::~SubSurface() {
   TRACE("%p %p", parent_, surface_);
+  if (surface_) {
+    surface_->RemoveSurfaceObserver(this);
+    surface_->set_sub_surface(nullptr);
+    // No longer a subsurface, what was cached is applied as committed.
+    surface_->ApplyCachedCommit();
+  }
   if (!parent_)
     return;
 
@@ -38,9 +45,21 @@ void SubSurface::SetPosition(int32_t x, int32_t y) {
 
 void SubSurface::SetCommitBehavior(bool sync) {
   is_synchronized_ = sync;
+  if (surface_ && !IsSynchronized())
+    surface_->ApplyCachedCommit();
+}
+
+bool SubSurface::IsSynchronized() {
+  if (is_synchronized_)
+    return true;
+  auto* parent = parent_ ? parent_->sub_surface() : nullptr;
+  return parent && parent->IsSynchronized();
 }
 
 void SubSurface::OnCommit(Surface* committed_surface) {
+  // Commits of the subsurface itself are cached by it.
+  if (committed_surface != parent_ || !surface_)
+    return;
   TRACE("parent: %p, surface: %p", parent_, surface_);
   while (!pending_placement_.empty()) {
     auto placement = pending_placement_.front();
@@ -59,15 +78,15 @@ void SubSurface::OnCommit(Surface* committed_surface) {
     surface_->window()->PushProperty(true, position_.x(), position_.y());
     position_dirty_ = false;
   }
-  if (is_synchronized_) {
-    LOG_ERROR << "Cascading commit" << std::endl;
-    surface_->Commit();
-  }
+  // Applying the cached state commits to the subsurface's own children in
+  // turn, so the tree is applied in one go and drawn in one frame.
+  surface_->ApplyCachedCommit();
 }
 
 void SubSurface::OnSurfaceDestroyed(Surface* surface) {
   if (surface == surface_) {
-    parent_->window()->RemoveChild(surface->window());
+    if (parent_)
+      parent_->window()->RemoveChild(surface->window());
     surface_ = nullptr;
   }
   if (surface == parent_) {
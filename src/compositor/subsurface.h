@@ -9,6 +9,10 @@
 
 namespace naive {
 
+// Places a surface within its parent. A synchronized subsurface caches its
+// commits and applies them when its parent's state is applied, so the whole
+// tree changes at once; it is synchronized when set so or when its parent
+// is.
 class SubSurface : public SurfaceObserver {
  public:
   SubSurface(Surface* parent, Surface* surface);
@@ -17,6 +21,7 @@ class SubSurface : public SurfaceObserver {
   void PlaceAbove(Surface* target);
   void PlaceBelow(Surface* target);
   void SetCommitBehavior(bool sync);
+  bool IsSynchronized();
 
   // SurfaceObserver overrides
   void OnCommit(Surface* committed_surface) override;
@@ -30,7 +35,7 @@ class SubSurface : public SurfaceObserver {
   bool position_dirty_{false};
 
   std::deque<std::pair<bool, Surface*>> pending_placement_;
-  bool is_synchronized_;
+  bool is_synchronized_{true};
 };
 
 }  // namespace naive
@@ -0,0 +1,208 @@
+#include "compositor/subtree_cache.h"
+
+#include <GLES3/gl3ext.h>
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "compositor/compositor_view.h"
+#include "compositor/gl_renderer.h"
+#include "compositor/texture_delegate.h"
+#include "wm/window_impl.h"
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+// Frames a subtree has to stay unchanged before it is copied, so subtrees
+// that change every frame are not rendered twice.
+constexpr int32_t kStableFrames = 2;
+// Largest copy, in pixels along either side.
+constexpr int32_t kMaxExtent = 4096;
+
+bool SameRect(const base::geometry::Rect& a, const base::geometry::Rect& b) {
+  return a.x() == b.x() && a.y() == b.y() && a.width() == b.width() &&
+         a.height() == b.height();
+}
+
+void FillQuad(GlRenderer* renderer, const base::geometry::Rect& rect) {
+  GLint coords[] = {
+      rect.x(),
+      rect.y(),
+      rect.x(),
+      rect.y() + rect.height(),
+      rect.x() + rect.width(),
+      rect.y() + rect.height(),
+      rect.x() + rect.width(),
+      rect.y(),
+  };
+  renderer->DrawSolidQuad(coords, 0.0f, 0.0f, 0.0f, 1.0f, true);
+}
+
+}  // namespace
+
+SubtreeCache::SubtreeCache(GlRenderer* renderer) : renderer_(renderer) {}
+
+SubtreeCache::~SubtreeCache() {
+  ReleaseFrameBuffer();
+}
+
+bool SubtreeCache::Update(const std::vector<CompositorView*>& views,
+                          bool changed) {
+  auto origin = views.front()->global_bounds();
+  std::vector<Member> members;
+  for (auto* view : views) {
+    auto* window = view->window();
+    auto bounds = view->global_bounds();
+    bounds.x_ -= origin.x();
+    bounds.y_ -= origin.y();
+    members.push_back({window, bounds,
+                       window->GetToDrawRegion() *
+                           window->window_impl()->GetScale()});
+  }
+  // Moving the subtree as a whole keeps the copy valid.
+  origin_x_ = origin.x();
+  origin_y_ = origin.y();
+
+  bool same = members.size() == members_.size();
+  for (size_t i = 0; same && i < members.size(); i++) {
+    same = members[i].window == members_[i].window &&
+           SameRect(members[i].bounds, members_[i].bounds) &&
+           SameRect(members[i].draw_rect, members_[i].draw_rect);
+  }
+  if (changed || !same) {
+    members_ = std::move(members);
+    stable_frames_ = 0;
+    valid_ = false;
+    return false;
+  }
+
+  if (valid_)
+    return true;
+  if (++stable_frames_ < kStableFrames)
+    return false;
+  valid_ = Render(views);
+  return valid_;
+}
+
+bool SubtreeCache::Render(const std::vector<CompositorView*>& views) {
+  int32_t x0 = members_.front().bounds.x();
+  int32_t y0 = members_.front().bounds.y();
+  int32_t x1 = x0 + members_.front().bounds.width();
+  int32_t y1 = y0 + members_.front().bounds.height();
+  for (auto& member : members_) {
+    x0 = std::min(x0, member.bounds.x());
+    y0 = std::min(y0, member.bounds.y());
+    x1 = std::max(x1, member.bounds.x() + member.bounds.width());
+    y1 = std::max(y1, member.bounds.y() + member.bounds.height());
+  }
+  extent_ = base::geometry::Rect(x0, y0, x1 - x0, y1 - y0);
+  if (extent_.Empty() || extent_.width() > kMaxExtent ||
+      extent_.height() > kMaxExtent) {
+    ReleaseFrameBuffer();
+    return false;
+  }
+
+  if (extent_.width() != texture_width_ || extent_.height() != texture_height_)
+    AllocateFrameBuffer(extent_.width(), extent_.height());
+  if (!framebuffer_)
+    return false;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  renderer_->SetProjection(origin_x_ + extent_.x(), origin_y_ + extent_.y(),
+                           extent_.width(), extent_.height());
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  // Adding alpha unscaled keeps the copy premultiplied.
+  renderer_->SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE,
+                          GL_ONE_MINUS_SRC_ALPHA);
+  for (auto* view : views) {
+    auto* texture = view->window()->window_impl()->CachedTexture();
+    if (!texture)
+      continue;
+    auto bounds = view->global_bounds();
+    for (auto& rect : view->draw_region().rectangles()) {
+      texture->Draw(bounds.x(), bounds.y(), rect.x() - bounds.x(),
+                    rect.y() - bounds.y(), rect.width(), rect.height(),
+                    DrawPass::kAll);
+    }
+
+    // Content drawn without blending, such as XRGB buffers, leaves undefined
+    // alpha behind; opaque parts are set to alpha 1.
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_TRUE);
+    renderer_->SetBlend(false);
+    for (auto& rect : view->opaque_region().rectangles())
+      FillQuad(renderer_, rect);
+    renderer_->SetBlend(true);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  }
+  renderer_->SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  renderer_->ResetProjection();
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return true;
+}
+
+void SubtreeCache::Draw(const std::vector<base::geometry::Rect>& rects) {
+  int32_t x = origin_x_ + extent_.x();
+  int32_t y = origin_y_ + extent_.y();
+  float width = extent_.width();
+  float height = extent_.height();
+  renderer_->SetBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  for (auto& rect : rects) {
+    GLint vertices[] = {rect.x(),
+                        rect.y() + rect.height(),
+                        rect.x(),
+                        rect.y(),
+                        rect.x() + rect.width(),
+                        rect.y(),
+                        rect.x() + rect.width(),
+                        rect.y() + rect.height()};
+    // The copy was rendered with the top of the subtree in its last row.
+    float left = (rect.x() - x) / width;
+    float right = (rect.x() + rect.width() - x) / width;
+    float top = 1.0f - (rect.y() - y) / height;
+    float bottom = 1.0f - (rect.y() + rect.height() - y) / height;
+    GLfloat tex_coords[] = {
+        left, bottom, left, top, right, top, right, bottom,
+    };
+    renderer_->DrawTextureQuad(vertices, tex_coords, texture_, false);
+  }
+  renderer_->SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void SubtreeCache::AllocateFrameBuffer(int32_t width, int32_t height) {
+  ReleaseFrameBuffer();
+  glGenTextures(1, &texture_);
+  renderer_->BindTexture(texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, nullptr);
+
+  glGenFramebuffers(1, &framebuffer_);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         texture_, 0);
+  bool complete =
+      glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (!complete) {
+    LOG_ERROR << "subtree cache frame buffer incomplete";
+    ReleaseFrameBuffer();
+    return;
+  }
+  texture_width_ = width;
+  texture_height_ = height;
+}
+
+void SubtreeCache::ReleaseFrameBuffer() {
+  if (framebuffer_)
+    glDeleteFramebuffers(1, &framebuffer_);
+  renderer_->DeleteTexture(&texture_);
+  framebuffer_ = 0;
+  texture_width_ = texture_height_ = 0;
+}
+
+}  // namespace compositor
+}  // namespace naive
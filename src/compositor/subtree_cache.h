@@ -0,0 +1,68 @@
+#ifndef COMPOSITOR_SUBTREE_CACHE_H_
+#define COMPOSITOR_SUBTREE_CACHE_H_
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <vector>
+
+#include "base/geometry.h"
+
+namespace naive {
+namespace wm {
+class Window;
+}  // namespace wm
+
+namespace compositor {
+
+class CompositorView;
+class GlRenderer;
+
+// An offscreen copy of a window subtree, a top-level window together with its
+// subsurfaces and popups. Once none of its members committed or moved for a
+// few frames, the subtree is rendered into a texture and drawn from it as one
+// quad per rectangle instead of view by view. The copy holds premultiplied
+// alpha, so drawing it blends the same as drawing the members in order.
+class SubtreeCache {
+ public:
+  explicit SubtreeCache(GlRenderer* renderer);
+  ~SubtreeCache();
+
+  // Checks the views of the subtree, bottom to top, against the cached copy.
+  // |changed| tells whether any member changed its content this frame.
+  // Renders the copy if needed and returns whether it can be drawn.
+  bool Update(const std::vector<CompositorView*>& views, bool changed);
+
+  // Draws the copy over |rects|, in global coordinates.
+  void Draw(const std::vector<base::geometry::Rect>& rects);
+
+ private:
+  struct Member {
+    wm::Window* window;
+    // Bounds and drawn part of the window, relative to the subtree origin.
+    base::geometry::Rect bounds;
+    base::geometry::Rect draw_rect;
+  };
+
+  // Renders the views into the frame buffer. Returns false if the subtree is
+  // too large to be copied.
+  bool Render(const std::vector<CompositorView*>& views);
+  void AllocateFrameBuffer(int32_t width, int32_t height);
+  void ReleaseFrameBuffer();
+
+  GlRenderer* renderer_;
+  std::vector<Member> members_;
+  // Global position of the bottom view, which the members are relative to.
+  int32_t origin_x_ = 0, origin_y_ = 0;
+  // Area covered by the copy, relative to the origin.
+  base::geometry::Rect extent_;
+  int32_t stable_frames_ = 0;
+  bool valid_ = false;
+  GLuint framebuffer_ = 0;
+  GLuint texture_ = 0;
+  int32_t texture_width_ = 0, texture_height_ = 0;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_SUBTREE_CACHE_H_
@@ -1,10 +1,16 @@
 #include "compositor/surface.h"
 
 #include <algorithm>
+#include <cmath>
+
+#include <poll.h>
+#include <unistd.h>
 
 #include "compositor/buffer.h"
 #include "compositor/compositor.h"
+#include "compositor/subsurface.h"
 #include "wayland/display_metrics.h"
+#include "main_looper.h"
 #include "wm/window.h"
 
 namespace naive {
@@ -23,14 +29,26 @@ Surface::~Surface() {
               << std::endl;
     observer->OnSurfaceDestroyed(this);
   }
+
+  // Buffers of commits never applied are not read at all.
+  StopWaiting();
+  if (has_cached_commit_)
+    queued_commits_.push_back(cached_commit_);
+  for (auto& commit : queued_commits_) {
+    if (commit.state.release_point.timeline)
+      commit.state.release_point.timeline->Signal(
+          commit.state.release_point.point);
+  }
+  if (state_.release_point.timeline)
+    compositor::Compositor::Get()->SignalAfterFrame(state_.release_point);
 }
 
 void Surface::Attach(Buffer* buffer) {
   TRACE("attach buffer %p to window: %p", buffer, window());
-  if (buffer) {
+  // Attaching damages nothing by itself, clients damage what changed since
+  // the last buffer. Textures redo everything on a size or format change.
+  if (buffer)
     buffer->SetOwningSurface(this);
-    Damage(window_->geometry());
-  }
   buffer_attached_dirty_ = true;
   pending_state_.buffer = buffer;
 }
@@ -40,7 +58,11 @@ void Surface::SetFrameCallback(std::function<void()>* callback) {
 }
 
 void Surface::Damage(const base::geometry::Rect& rect) {
-  pending_state_.damaged_region.Union(rect * scale_);
+  pending_state_.surface_damage.Union(rect);
+}
+
+void Surface::DamageBuffer(const base::geometry::Rect& rect) {
+  pending_state_.damaged_region.Union(rect);
 }
 
 void Surface::SetOpaqueRegion(const Region region) {
@@ -51,18 +73,246 @@ void Surface::SetInputRegion(const Region region) {
   pending_state_.input_region = region;
 }
 
+void Surface::SetViewportSource(float x,
+                                float y,
+                                float width,
+                                float height) {
+  pending_state_.source_x = x;
+  pending_state_.source_y = y;
+  pending_state_.source_width = width;
+  pending_state_.source_height = height;
+  viewport_dirty_ = true;
+}
+
+void Surface::SetViewportDestination(int32_t width, int32_t height) {
+  pending_state_.destination_width = width;
+  pending_state_.destination_height = height;
+  viewport_dirty_ = true;
+}
+
+Surface::ViewportError Surface::CheckViewport() {
+  auto& state = pending_state_;
+  if (state.source_width < 0)
+    return ViewportError::kNone;
+  // Without a destination, the surface takes the size of the source.
+  if (state.destination_width < 0 &&
+      (state.source_width != std::floor(state.source_width) ||
+       state.source_height != std::floor(state.source_height)))
+    return ViewportError::kBadSize;
+  Buffer* buffer = state.buffer;
+  if (!buffer)
+    return ViewportError::kNone;
+  // The source is given in the buffer as transformed; turns by 90 and 270
+  // degrees swap its axes.
+  int32_t width = buffer->width();
+  int32_t height = buffer->height();
+  if (state.transform & 1)
+    std::swap(width, height);
+  if ((state.source_x + state.source_width) * scale_ > width ||
+      (state.source_y + state.source_height) * scale_ > height)
+    return ViewportError::kOutOfBuffer;
+  return ViewportError::kNone;
+}
+
+compositor::BufferViewport Surface::viewport() {
+  compositor::BufferViewport viewport;
+  viewport.SetTransform(state_.transform);
+  if (state_.source_width >= 0) {
+    viewport.SetSource(state_.source_x * scale_, state_.source_y * scale_,
+                       state_.source_width * scale_,
+                       state_.source_height * scale_);
+  }
+  if (state_.destination_width >= 0) {
+    viewport.SetDestination(state_.destination_width * scale_,
+                            state_.destination_height * scale_);
+  }
+  if (buffer_width_ > 0)
+    viewport.Resolve(buffer_width_, buffer_height_);
+  return viewport;
+}
+
+Surface::SyncError Surface::CheckSync() {
+  if (!sync_resource_)
+    return SyncError::kNone;
+  auto& state = pending_state_;
+  if (!state.buffer) {
+    if (state.acquire_point.timeline || state.release_point.timeline)
+      return SyncError::kNoBuffer;
+    return SyncError::kNone;
+  }
+  // Timeline points only make sense for dmabufs, which the GPU renders into.
+  if (!state.buffer->is_dmabuf())
+    return SyncError::kUnsupportedBuffer;
+  if (!state.acquire_point.timeline)
+    return SyncError::kNoAcquirePoint;
+  if (!state.release_point.timeline)
+    return SyncError::kNoReleasePoint;
+  if (state.acquire_point.timeline == state.release_point.timeline &&
+      state.acquire_point.point >= state.release_point.point)
+    return SyncError::kConflictingPoints;
+  return SyncError::kNone;
+}
+
 void Surface::Commit() {
   TRACE("window: %p, surface: %p", window(), this);
-  if (pending_state_.buffer != state_.buffer && state_.buffer)
-    state_.buffer->Release();
-  state_ = pending_state_;
+  QueuedCommit commit = {pending_state_, buffer_attached_dirty_,
+                         viewport_dirty_};
+  pending_state_.frame_callback = nullptr;
+  pending_state_.buffer = nullptr;
+  pending_state_.damaged_region = Region::Empty();
+  pending_state_.surface_damage = Region::Empty();
+  pending_state_.acquire_point = compositor::SyncPoint();
+  pending_state_.release_point = compositor::SyncPoint();
+  buffer_attached_dirty_ = false;
+  viewport_dirty_ = false;
+
+  // A synchronized subsurface shows its state together with its parent's.
+  if (sub_surface_ && sub_surface_->IsSynchronized()) {
+    CacheCommit(commit);
+    return;
+  }
+  ApplyOrQueueCommit(commit);
+}
+
+void Surface::ApplyCachedCommit() {
+  if (!has_cached_commit_)
+    return;
+  has_cached_commit_ = false;
+  QueuedCommit commit = cached_commit_;
+  cached_commit_ = QueuedCommit();
+  ApplyOrQueueCommit(commit);
+}
+
+void Surface::CacheCommit(QueuedCommit commit) {
+  if (!has_cached_commit_) {
+    cached_commit_ = commit;
+    has_cached_commit_ = true;
+    return;
+  }
+
+  // Commits pile up into one, the newer state replacing the older.
+  auto& cached = cached_commit_;
+  if (!commit.buffer_attached_dirty) {
+    commit.state.buffer = cached.state.buffer;
+    commit.state.acquire_point = cached.state.acquire_point;
+    commit.state.release_point = cached.state.release_point;
+  } else {
+    // The cached buffer is replaced before it was ever shown.
+    if (cached.state.buffer && cached.state.buffer != commit.state.buffer)
+      cached.state.buffer->Release();
+    if (cached.state.release_point.timeline) {
+      cached.state.release_point.timeline->Signal(
+          cached.state.release_point.point);
+    }
+  }
+  commit.buffer_attached_dirty |= cached.buffer_attached_dirty;
+  commit.viewport_dirty |= cached.viewport_dirty;
+  // The pending regions were replaced on commit, they are not shared.
+  commit.state.damaged_region.Union(cached.state.damaged_region);
+  commit.state.surface_damage.Union(cached.state.surface_damage);
+  // Only one frame callback is kept, an older one is done right away.
+  if (!commit.state.frame_callback)
+    commit.state.frame_callback = cached.state.frame_callback;
+  else if (cached.state.frame_callback)
+    (*cached.state.frame_callback)();
+  cached_commit_ = commit;
+}
+
+void Surface::ApplyOrQueueCommit(const QueuedCommit& commit) {
+  // A buffer the client is still rendering into is not shown until its
+  // acquire point signals; the commit waits for it in the main loop, and
+  // later commits wait behind it to keep their order.
+  auto& acquire = commit.state.acquire_point;
+  if (!queued_commits_.empty() ||
+      (acquire.timeline && !acquire.timeline->IsSignaled(acquire.point))) {
+    queued_commits_.push_back(commit);
+    if (queued_commits_.size() == 1)
+      WaitForAcquirePoint();
+    return;
+  }
+  ApplyCommit(commit);
+}
+
+void Surface::WaitForAcquirePoint() {
+  auto& acquire = queued_commits_.front().state.acquire_point;
+  acquire_fd_ = acquire.timeline->CreateWaitFd(acquire.point);
+  if (acquire_fd_ < 0) {
+    // Explicit sync is only offered where eventfds work, so this is out of
+    // fds or memory. The commit is applied rather than stalling the
+    // compositor on the point.
+    LOG_ERROR << "cannot wait for acquire point " << acquire.point
+              << ", applying the commit" << std::endl;
+    QueuedCommit commit = queued_commits_.front();
+    queued_commits_.pop_front();
+    ApplyCommit(commit);
+    ApplyQueuedCommits();
+    return;
+  }
+  MainLooper::Get()->AddFd(acquire_fd_, [this]() {
+    // Every handler runs on each iteration, so check the fd first.
+    pollfd pfd = {.fd = acquire_fd_, .events = POLLIN};
+    if (poll(&pfd, 1, 0) <= 0)
+      return;
+    StopWaiting();
+    ApplyQueuedCommits();
+  });
+}
+
+void Surface::StopWaiting() {
+  if (acquire_fd_ < 0)
+    return;
+  MainLooper::Get()->RemoveFd(acquire_fd_);
+  close(acquire_fd_);
+  acquire_fd_ = -1;
+}
+
+void Surface::ApplyQueuedCommits() {
+  while (!queued_commits_.empty()) {
+    auto& acquire = queued_commits_.front().state.acquire_point;
+    if (acquire.timeline && !acquire.timeline->IsSignaled(acquire.point)) {
+      WaitForAcquirePoint();
+      return;
+    }
+    QueuedCommit commit = queued_commits_.front();
+    queued_commits_.pop_front();
+    ApplyCommit(commit);
+  }
+}
+
+void Surface::ApplyCommit(const QueuedCommit& commit) {
+  if (commit.state.buffer != state_.buffer && state_.buffer) {
+    // A buffer sampled in place is read until the GPU finished the frames
+    // drawn with it, a copied one was read when it was uploaded.
+    if (state_.buffer->MaybeImported())
+      compositor::Compositor::Get()->ReleaseAfterFrame(state_.buffer);
+    else
+      state_.buffer->Release();
+  }
+  // Attached again before its release was sent, it is in use once more.
+  if (commit.state.buffer)
+    compositor::Compositor::Get()->CancelRelease(commit.state.buffer);
+  // The replaced buffer may still be read by the frame drawn with it.
+  if (state_.release_point.timeline)
+    compositor::Compositor::Get()->SignalAfterFrame(state_.release_point);
+  // Damage not yet picked up by the compositor is carried over, as textures
+  // only upload damaged content.
+  Region damage = state_.damaged_region;
+  state_ = commit.state;
+  state_.damaged_region.Union(damage);
+  if (state_.buffer) {
+    buffer_width_ = state_.buffer->width();
+    buffer_height_ = state_.buffer->height();
+  }
   if (!state_.buffer || !state_.buffer->data())
     TRACE("window: %p does not have buffer", window());
   has_commit_ = true;
+  if (!window()->top_level()->is_visible())
+    compositor::Compositor::Get()->OnHiddenWindowCommit(window());
 
-  pending_state_.frame_callback = nullptr;
-  pending_state_.buffer = nullptr;
-  pending_state_.damaged_region = Region::Empty();
+  // Surface damage is taken into the buffer with the state just committed.
+  for (auto& rect : state_.surface_damage.rectangles())
+    AddSurfaceDamage(rect);
+  state_.surface_damage = Region::Empty();
 
   // TODO: Can't use iterator due to possible iterator invalidation...
   // needs revisit
@@ -72,20 +322,36 @@ void Surface::Commit() {
     observer->OnCommit(this);
   }
 
-  // IF dirty buffer attach:
-  if (state_.buffer && buffer_attached_dirty_) {
-    wayland::DisplayMetrics* metrics =
-        compositor::Compositor::Get()->GetDisplayMetrics();
-    window_->PushProperty(false, state_.buffer->width() / metrics->scale,
-                          state_.buffer->height() / metrics->scale);
-    buffer_attached_dirty_ = false;
+  // IF dirty buffer attach or viewport; a viewport sets the surface size.
+  if ((state_.buffer && commit.buffer_attached_dirty) ||
+      commit.viewport_dirty) {
+    int32_t width = -1, height = -1;
+    if (state_.destination_width >= 0) {
+      width = state_.destination_width;
+      height = state_.destination_height;
+    } else if (state_.source_width >= 0) {
+      width = std::lround(state_.source_width);
+      height = std::lround(state_.source_height);
+    } else if (state_.buffer) {
+      wayland::DisplayMetrics* metrics =
+          compositor::Compositor::Get()->GetDisplayMetrics();
+      width = state_.buffer->width() / metrics->scale;
+      height = state_.buffer->height() / metrics->scale;
+      if (state_.transform & 1)
+        std::swap(width, height);
+    }
+    if (width >= 0)
+      window_->PushProperty(false, width, height);
   }
 }
 
 void Surface::ForceDamage(base::geometry::Rect rect) {
   TRACE("force damage %s on %p", rect.ToString().c_str(), window());
-  // Region r = Region(rect * scale_);
-  state_.damaged_region.Union(rect * scale_);
+  AddSurfaceDamage(rect);
+}
+
+void Surface::AddSurfaceDamage(const base::geometry::Rect& rect) {
+  state_.damaged_region.Union(viewport().ViewToBuffer(rect * scale_));
 }
 
 }  // namespace naive
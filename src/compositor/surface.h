@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -12,7 +13,9 @@
 
 #include "base/geometry.h"
 #include "base/logging.h"
+#include "compositor/buffer_viewport.h"
 #include "compositor/region.h"
+#include "compositor/sync_timeline.h"
 #include "compositor/texture_delegate.h"
 
 namespace naive {
@@ -26,6 +29,7 @@ class TextureDelegate;
 }  // namespace compositor
 
 class Buffer;
+class SubSurface;
 class Surface;
 
 class SurfaceObserver {
@@ -36,15 +40,53 @@ class SurfaceObserver {
 
 class Surface {
  public:
+  enum class ViewportError { kNone, kBadSize, kOutOfBuffer };
+  enum class SyncError {
+    kNone,
+    kNoBuffer,
+    kUnsupportedBuffer,
+    kNoAcquirePoint,
+    kNoReleasePoint,
+    kConflictingPoints,
+  };
+
   Surface();
   ~Surface();
   void Attach(Buffer* buffer);
+  // Damages |rect| in surface coordinates.
   void Damage(const base::geometry::Rect& rect);
+  // Damages |rect| in buffer coordinates.
+  void DamageBuffer(const base::geometry::Rect& rect);
   void SetOpaqueRegion(const Region region);
   void SetInputRegion(const Region region);
   void Commit();
   void SetFrameCallback(std::function<void()>* callback);
   void SetBufferScale(int32_t scale) { scale_ = scale; }
+  // One of the wl_output_transform values.
+  void SetBufferTransform(int32_t transform) {
+    pending_state_.transform = transform;
+    viewport_dirty_ = true;
+  }
+  // Crop and scale of the buffer, in surface coordinates. A negative width
+  // unsets them.
+  void SetViewportSource(float x, float y, float width, float height);
+  void SetViewportDestination(int32_t width, int32_t height);
+  // Checks the pending crop and scale against the pending buffer.
+  ViewportError CheckViewport();
+  // How the committed buffer maps onto the view, in pixels.
+  compositor::BufferViewport viewport();
+  // Explicit synchronization points of the pending buffer. The commit is
+  // applied once the acquire point signals, and the release point is
+  // signaled once the compositor is done with the buffer.
+  void SetAcquirePoint(const compositor::SyncPoint& point) {
+    pending_state_.acquire_point = point;
+  }
+  void SetReleasePoint(const compositor::SyncPoint& point) {
+    pending_state_.release_point = point;
+  }
+  // Checks the pending points against the pending buffer, once the surface
+  // is explicitly synchronized.
+  SyncError CheckSync();
 
   void AddSurfaceObserver(SurfaceObserver* observer) {
     TRACE("Add observer: %p to surface %p", observer, this);
@@ -74,12 +116,33 @@ class Surface {
       pending_state_.buffer = nullptr;
     if (buffer == state_.buffer)
       state_.buffer = nullptr;
+    for (auto& commit : queued_commits_) {
+      if (buffer == commit.state.buffer)
+        commit.state.buffer = nullptr;
+    }
+    if (buffer == cached_commit_.state.buffer)
+      cached_commit_.state.buffer = nullptr;
   }
 
+  // Set while the surface is a subsurface.
+  void set_sub_surface(SubSurface* sub_surface) { sub_surface_ = sub_surface; }
+  SubSurface* sub_surface() { return sub_surface_; }
+  // Applies the state a synchronized subsurface cached since its parent last
+  // committed, if any.
+  void ApplyCachedCommit();
+
   void ForceDamage(base::geometry::Rect rect);
+  // Damage of the committed buffer, in buffer coordinates.
   Region damaged_regoin() { return state_.damaged_region; }
+  Region opaque_region() { return state_.opaque_region.Clone(); }
   void set_resource(wl_resource* resource) { resource_ = resource; }
   wl_resource* resource() { return resource_; }
+  void set_viewport_resource(wl_resource* resource) {
+    viewport_resource_ = resource;
+  }
+  wl_resource* viewport_resource() { return viewport_resource_; }
+  void set_sync_resource(wl_resource* resource) { sync_resource_ = resource; }
+  wl_resource* sync_resource() { return sync_resource_; }
   bool has_commit() { return has_commit_; }
   void force_commit() { has_commit_ = true; }
   void clear_commit() { has_commit_ = false; }
@@ -100,23 +163,64 @@ class Surface {
   }
 
  private:
+  struct QueuedCommit;
+
+  // Adds damage in surface coordinates to the committed buffer damage.
+  void AddSurfaceDamage(const base::geometry::Rect& rect);
+  // Merges |commit| into the state cached while synchronized.
+  void CacheCommit(QueuedCommit commit);
+  void ApplyOrQueueCommit(const QueuedCommit& commit);
+  void ApplyCommit(const QueuedCommit& commit);
+  // Applies queued commits in order, up to the first still waiting.
+  void ApplyQueuedCommits();
+  // Waits in the main loop for the acquire point of the first queued commit.
+  void WaitForAcquirePoint();
+  void StopWaiting();
+
   struct SurfaceState {
+    // In buffer coordinates.
     Region damaged_region = Region::Empty();
+    // Damage in surface coordinates, taken into the buffer on commit.
+    Region surface_damage = Region::Empty();
     Region opaque_region = Region::Empty();
     Region input_region = Region::Empty();
     Buffer* buffer = nullptr;
     std::function<void()>* frame_callback = nullptr;
+    float source_x = 0, source_y = 0, source_width = -1, source_height = -1;
+    int32_t destination_width = -1, destination_height = -1;
+    int32_t transform = WL_OUTPUT_TRANSFORM_NORMAL;
+    compositor::SyncPoint acquire_point;
+    compositor::SyncPoint release_point;
+  };
+
+  // A commit cached while synchronized, or waiting for the acquire point of
+  // its buffer.
+  struct QueuedCommit {
+    SurfaceState state;
+    bool buffer_attached_dirty = false;
+    bool viewport_dirty = false;
   };
 
   SurfaceState pending_state_;
   SurfaceState state_;
   bool buffer_attached_dirty_{false};
+  bool viewport_dirty_{false};
+  std::deque<QueuedCommit> queued_commits_;
+  QueuedCommit cached_commit_;
+  bool has_cached_commit_ = false;
+  SubSurface* sub_surface_ = nullptr;
+  // Polled for the acquire point of the first queued commit, -1 if none.
+  int acquire_fd_ = -1;
 
   wl_resource* resource_;
+  wl_resource* viewport_resource_ = nullptr;
+  wl_resource* sync_resource_ = nullptr;
   bool has_commit_ = false;
   std::vector<SurfaceObserver*> observers_;
   std::unique_ptr<wm::Window> window_;
   uint32_t scale_{1};
+  // Size of the last committed buffer.
+  int32_t buffer_width_ = 0, buffer_height_ = 0;
 
   std::unique_ptr<compositor::TextureDelegate> cached_texture_;
 };
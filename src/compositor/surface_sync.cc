@@ -0,0 +1,33 @@
+#include "compositor/surface_sync.h"
+
+namespace naive {
+
+SurfaceSync::SurfaceSync(Surface* surface) : surface_(surface) {
+  TRACE("%p, surface: %p", this, surface);
+  surface_->AddSurfaceObserver(this);
+}
+
+SurfaceSync::~SurfaceSync() {
+  TRACE("%p, surface: %p", this, surface_);
+  if (!surface_)
+    return;
+  surface_->SetAcquirePoint(compositor::SyncPoint());
+  surface_->SetReleasePoint(compositor::SyncPoint());
+  surface_->set_sync_resource(nullptr);
+  surface_->RemoveSurfaceObserver(this);
+}
+
+void SurfaceSync::SetAcquirePoint(const compositor::SyncPoint& point) {
+  surface_->SetAcquirePoint(point);
+}
+
+void SurfaceSync::SetReleasePoint(const compositor::SyncPoint& point) {
+  surface_->SetReleasePoint(point);
+}
+
+void SurfaceSync::OnSurfaceDestroyed(Surface* surface) {
+  if (surface == surface_)
+    surface_ = nullptr;
+}
+
+}  // namespace naive
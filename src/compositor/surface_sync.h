@@ -0,0 +1,32 @@
+#ifndef COMPOSITOR_SURFACE_SYNC_H_
+#define COMPOSITOR_SURFACE_SYNC_H_
+
+#include "compositor/surface.h"
+#include "compositor/sync_timeline.h"
+
+namespace naive {
+
+// Explicit synchronization of a surface, as set through
+// wp_linux_drm_syncobj_surface_v1. Points set and not yet committed are
+// dropped once it goes away.
+class SurfaceSync : public SurfaceObserver {
+ public:
+  explicit SurfaceSync(Surface* surface);
+  ~SurfaceSync();
+
+  void SetAcquirePoint(const compositor::SyncPoint& point);
+  void SetReleasePoint(const compositor::SyncPoint& point);
+
+  // The surface, or null once it is destroyed.
+  Surface* surface() { return surface_; }
+
+  // SurfaceObserver overrides
+  void OnSurfaceDestroyed(Surface* surface) override;
+
+ private:
+  Surface* surface_;
+};
+
+}  // namespace naive
+
+#endif  // COMPOSITOR_SURFACE_SYNC_H_
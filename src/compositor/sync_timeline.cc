@@ -0,0 +1,128 @@
+#include "compositor/sync_timeline.h"
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <xf86drm.h>
+#include <cstdint>
+
+#include "base/logging.h"
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+constexpr int kMaxDevices = 16;
+
+// Render node syncobjs are imported into, opened on first use; -2 until then
+// and -1 if there is none.
+int g_device = -2;
+
+// Whether the kernel signals eventfds for timeline points, which acquire
+// points are waited on with rather than by blocking.
+bool SupportsEventfd(int fd) {
+  uint32_t handle = 0;
+  if (drmSyncobjCreate(fd, 0, &handle))
+    return false;
+  int event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  bool supported =
+      event_fd >= 0 && drmSyncobjEventfd(fd, handle, 1, event_fd, 0) == 0;
+  if (event_fd >= 0)
+    close(event_fd);
+  drmSyncobjDestroy(fd, handle);
+  return supported;
+}
+
+int Device() {
+  if (g_device != -2)
+    return g_device;
+  g_device = -1;
+  drmDevicePtr devices[kMaxDevices];
+  int count = drmGetDevices2(0, devices, kMaxDevices);
+  for (int i = 0; i < count && g_device < 0; i++) {
+    if (!(devices[i]->available_nodes & (1 << DRM_NODE_RENDER)))
+      continue;
+    int fd = open(devices[i]->nodes[DRM_NODE_RENDER], O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+      continue;
+    uint64_t timeline = 0;
+    if (drmGetCap(fd, DRM_CAP_SYNCOBJ_TIMELINE, &timeline) == 0 && timeline &&
+        SupportsEventfd(fd))
+      g_device = fd;
+    else
+      close(fd);
+  }
+  if (count > 0)
+    drmFreeDevices(devices, count);
+  if (g_device < 0)
+    LOG_INFO << "no DRM device with timeline syncobj eventfds, explicit sync "
+                "disabled"
+             << std::endl;
+  return g_device;
+}
+
+}  // namespace
+
+// static
+bool SyncTimeline::Supported() {
+  return Device() >= 0;
+}
+
+// static
+std::shared_ptr<SyncTimeline> SyncTimeline::Import(int fd) {
+  uint32_t handle = 0;
+  int result = Device() >= 0 ? drmSyncobjFDToHandle(Device(), fd, &handle) : -1;
+  close(fd);
+  if (result)
+    return nullptr;
+  return std::shared_ptr<SyncTimeline>(new SyncTimeline(handle));
+}
+
+SyncTimeline::~SyncTimeline() {
+  drmSyncobjDestroy(Device(), handle_);
+}
+
+bool SyncTimeline::IsSignaled(uint64_t point) {
+  uint64_t value = 0;
+  if (drmSyncobjQuery(Device(), &handle_, &value, 1))
+    return false;
+  return value >= point;
+}
+
+void SyncTimeline::Signal(uint64_t point) {
+  if (drmSyncobjTimelineSignal(Device(), &handle_, &point, 1))
+    LOG_ERROR << "failed to signal timeline point " << point << std::endl;
+}
+
+int SyncTimeline::CreateWaitFd(uint64_t point) {
+  // A point whose work was submitted already has a fence, exported as a sync
+  // file that polls readable once it signals.
+  uint64_t points[] = {point};
+  if (drmSyncobjTimelineWait(Device(), &handle_, points, 1, 0,
+                             DRM_SYNCOBJ_WAIT_FLAGS_WAIT_AVAILABLE,
+                             nullptr) == 0) {
+    uint32_t binary = 0;
+    int sync_file = -1;
+    if (drmSyncobjCreate(Device(), 0, &binary) == 0) {
+      if (drmSyncobjTransfer(Device(), binary, 0, handle_, point, 0) == 0)
+        drmSyncobjExportSyncFile(Device(), binary, &sync_file);
+      drmSyncobjDestroy(Device(), binary);
+    }
+    if (sync_file >= 0)
+      return sync_file;
+  }
+
+  // Otherwise the kernel signals an eventfd once the point signals.
+  int event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (event_fd < 0)
+    return -1;
+  if (drmSyncobjEventfd(Device(), handle_, point, event_fd, 0)) {
+    close(event_fd);
+    return -1;
+  }
+  return event_fd;
+}
+
+}  // namespace compositor
+}  // namespace naive
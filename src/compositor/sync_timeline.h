@@ -0,0 +1,45 @@
+#ifndef COMPOSITOR_SYNC_TIMELINE_H_
+#define COMPOSITOR_SYNC_TIMELINE_H_
+
+#include <cstdint>
+#include <memory>
+
+namespace naive {
+namespace compositor {
+
+// A DRM syncobj timeline imported from a client for explicit
+// synchronization. Clients signal acquire points once their rendering into a
+// buffer is done, and the compositor signals release points once it no
+// longer reads from the buffer.
+class SyncTimeline {
+ public:
+  // Whether there is a DRM device with timeline syncobjs to import into,
+  // whose points can be waited on through eventfds.
+  static bool Supported();
+  // Imports the syncobj |fd|, which is closed. Returns null if it is not one.
+  static std::shared_ptr<SyncTimeline> Import(int fd);
+
+  ~SyncTimeline();
+
+  bool IsSignaled(uint64_t point);
+  void Signal(uint64_t point);
+  // Returns an fd that becomes readable once |point| is signaled, for the
+  // main loop to poll, or -1 if there is none. The caller closes it.
+  int CreateWaitFd(uint64_t point);
+
+ private:
+  explicit SyncTimeline(uint32_t handle) : handle_(handle) {}
+
+  uint32_t handle_;
+};
+
+// A point on a timeline; no point is set without a timeline.
+struct SyncPoint {
+  std::shared_ptr<SyncTimeline> timeline;
+  uint64_t point = 0;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_SYNC_TIMELINE_H_
@@ -0,0 +1,524 @@
+#include "compositor/texture.h"
+
+#include <GLES3/gl3ext.h>
+#include <wayland-server.h>
+#include <algorithm>
+#include <utility>
+
+#include "base/hash.h"
+#include "base/logging.h"
+#include "compositor/dmabuf_import.h"
+#include "compositor/gl_renderer.h"
+#include "compositor/pixel_scan.h"
+#include "compositor/shm_format.h"
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+// Number of rows hashed and uploaded as one unit.
+constexpr int32_t kBandHeight = 16;
+// Imports kept per texture, enough for triple buffering.
+constexpr size_t kMaxImports = 3;
+
+bool IsOpaque(uint32_t pixel) {
+  return (pixel >> 24) == 0xff;
+}
+
+uint32_t HashBand(uint32_t hash,
+                  const uint8_t* data,
+                  int32_t row_bytes,
+                  int32_t rows,
+                  int32_t stride) {
+  for (int32_t i = 0; i < rows; i++)
+    hash = base::Crc32c(hash, data + i * stride, row_bytes);
+  return hash;
+}
+
+// Texels of a plane subsampled by |subsampling| that cover |size| pixels.
+int32_t PlaneSize(int32_t size, int32_t subsampling) {
+  return (size + subsampling - 1) / subsampling;
+}
+
+}  // namespace
+
+Texture::Texture(GlRenderer* renderer) : renderer_(renderer) {}
+
+Texture::~Texture() {
+  TRACE();
+  for (auto& plane : planes_)
+    renderer_->DeleteTexture(&plane);
+  ReleaseImports();
+}
+
+void Texture::Reset(int32_t width, int32_t height, int32_t format) {
+  shm_format_ = FindShmFormat(format, renderer_->bgra_textures());
+  if (!shm_format_) {
+    TRACE("unsupported buffer format %d, taken as ARGB8888", format);
+    shm_format_ =
+        FindShmFormat(WL_SHM_FORMAT_ARGB8888, renderer_->bgra_textures());
+  }
+  width_ = width;
+  height_ = height;
+  format_ = format;
+  bytes_per_pixel_ = shm_format_->planes[0].bytes_per_texel;
+  swizzle_ =
+      shm_format_->bgra && shm_format_->planes[0].pixel_format == GL_RGBA;
+  needs_backdrop_ = !shm_format_->has_alpha;
+  solid_ = false;
+  bands_.assign((height_ + kBandHeight - 1) / kBandHeight, Band());
+  opaque_region_ =
+      needs_backdrop_ ? Region(base::geometry::Rect(0, 0, width_, height_))
+                      : Region::Empty();
+  pending_damage_.Clear();
+  ReleaseTexture();
+  ReleaseImports();
+  viewport_.Resolve(width_, height_);
+  UpdateFilter();
+}
+
+void Texture::AllocateTexture() {
+  for (int32_t i = 0; i < shm_format_->plane_count; i++) {
+    auto& plane = shm_format_->planes[i];
+    glGenTextures(1, &planes_[i]);
+    renderer_->BindTexture(planes_[i]);
+    GLint filter = linear_ ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexImage2D(GL_TEXTURE_2D, 0, plane.internal_format,
+                 PlaneSize(width_, plane.horizontal_subsampling),
+                 PlaneSize(height_, plane.vertical_subsampling), 0,
+                 plane.pixel_format, plane.type, nullptr);
+  }
+}
+
+void Texture::ReleaseTexture() {
+  for (auto& plane : planes_)
+    renderer_->DeleteTexture(&plane);
+  bands_.assign(bands_.size(), Band());
+}
+
+void Texture::UpdateFilter() {
+  // Packed YUV texels hold two pixels each, which the shader tells apart by
+  // position, so they are never interpolated.
+  bool linear = viewport_.scaled() && shm_format_ &&
+                shm_format_->yuv != YuvFormat::kYuyv;
+  if (linear == linear_)
+    return;
+  linear_ = linear;
+  GLint filter = linear_ ? GL_LINEAR : GL_NEAREST;
+  std::vector<GLuint> textures(planes_, planes_ + kMaxShmPlanes);
+  for (auto& import : imports_)
+    textures.push_back(import.texture);
+  for (auto texture : textures) {
+    if (!texture)
+      continue;
+    renderer_->BindTexture(texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  }
+}
+
+GLuint Texture::ImportDmaBuf(DrawQuad& quad) {
+  auto* importer = renderer_->dmabuf_importer();
+  // Only single plane RGB formats, which the GPU samples like uploaded ones.
+  if (quad.dmabuf_fd() < 0 || !importer->supported() ||
+      shm_format_->plane_count != 1 || shm_format_->yuv != YuvFormat::kNone ||
+      bytes_per_pixel_ != 4)
+    return 0;
+  for (auto iter = imports_.begin(); iter != imports_.end(); ++iter) {
+    if (iter->dmabuf_id == quad.dmabuf_id() &&
+        iter->offset == quad.offset() && iter->stride == quad.stride()) {
+      std::rotate(imports_.begin(), iter, iter + 1);
+      return imports_.front().texture;
+    }
+  }
+
+  Import import = {quad.dmabuf_id(), quad.offset(), quad.stride(),
+                   EGL_NO_IMAGE_KHR, 0};
+  import.image = importer->Import(quad.dmabuf_fd(), quad.offset(),
+                                  quad.stride(), width_, height_,
+                                  DrmFourcc(format_));
+  if (import.image != EGL_NO_IMAGE_KHR) {
+    glGenTextures(1, &import.texture);
+    renderer_->BindTexture(import.texture);
+    GLint filter = linear_ ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    importer->BindToTexture(import.image);
+  }
+  imports_.insert(imports_.begin(), import);
+  if (imports_.size() > kMaxImports) {
+    auto& oldest = imports_.back();
+    if (oldest.texture == imported_)
+      imported_ = 0;
+    renderer_->DeleteTexture(&oldest.texture);
+    importer->Release(oldest.image);
+    imports_.pop_back();
+  }
+  return import.texture;
+}
+
+void Texture::ReleaseImports() {
+  for (auto& import : imports_) {
+    renderer_->DeleteTexture(&import.texture);
+    renderer_->dmabuf_importer()->Release(import.image);
+  }
+  imports_.clear();
+  imported_ = 0;
+}
+
+bool Texture::ScanBand(size_t b, const uint8_t* data, int32_t stride) {
+  int32_t y = b * kBandHeight;
+  int32_t rows = std::min(kBandHeight, height_ - y);
+  int32_t start, end;
+  FindOpaqueSpan(data + y * stride, stride, width_, rows, &start, &end);
+  if (start == bands_[b].opaque_start && end == bands_[b].opaque_end)
+    return false;
+  bands_[b].opaque_start = start;
+  bands_[b].opaque_end = end;
+  return true;
+}
+
+void Texture::UpdateOpaqueRegion() {
+  opaque_region_ = Region::Empty();
+  for (size_t b = 0; b < bands_.size(); b++) {
+    if (bands_[b].opaque_start >= bands_[b].opaque_end)
+      continue;
+    int32_t y = b * kBandHeight;
+    opaque_region_.Union(base::geometry::Rect(
+        bands_[b].opaque_start, y,
+        bands_[b].opaque_end - bands_[b].opaque_start,
+        std::min(kBandHeight, height_ - y)));
+  }
+}
+
+void Texture::SetViewport(const BufferViewport& viewport) {
+  viewport_ = viewport;
+  viewport_.Resolve(width_, height_);
+  UpdateFilter();
+}
+
+UploadStats Texture::Update(DrawQuad& quad, Region& damage, Region& visible) {
+  UploadStats stats;
+  base::geometry::Rect bounds(0, 0, quad.width(), quad.height());
+  Region new_damage = damage.Clone();
+  if (bands_.empty() || quad.width() != width_ || quad.height() != height_ ||
+      quad.format() != format_) {
+    Reset(quad.width(), quad.height(), quad.format());
+    new_damage = Region(bounds);
+  }
+  new_damage.Intersect(bounds);
+
+  void* data = quad.data();
+  int32_t stride = quad.stride();
+  bool spans_changed = false;
+
+  GLuint imported = ImportDmaBuf(quad);
+  if (imported) {
+    // Nothing is uploaded, the buffer only has to be scanned for alpha.
+    if (!imported_) {
+      solid_ = false;
+      ReleaseTexture();
+      pending_damage_.Clear();
+      new_damage = Region(bounds);
+      spans_changed = true;
+    }
+    imported_ = imported;
+    for (auto& rect : new_damage.rectangles()) {
+      stats.bytes_imported += rect.width() * rect.height() * bytes_per_pixel_;
+      if (needs_backdrop_)
+        continue;
+      int32_t last_band = (rect.y() + rect.height() - 1) / kBandHeight;
+      for (int32_t b = rect.y() / kBandHeight; b <= last_band; b++)
+        spans_changed |= ScanBand(b, static_cast<uint8_t*>(data), stride);
+    }
+    if (spans_changed && !needs_backdrop_)
+      UpdateOpaqueRegion();
+    return stats;
+  }
+  if (imported_) {
+    // Back to copying, the textures hold nothing yet.
+    imported_ = 0;
+    new_damage = Region(bounds);
+  }
+  if (solid_ && !new_damage.is_empty()) {
+    // Stay a solid fill as long as the damage keeps the color.
+    uint64_t bytes = 0;
+    bool still_solid = true;
+    for (auto& rect : new_damage.rectangles()) {
+      if (!MatchesColor(data, stride, rect, solid_color_)) {
+        still_solid = false;
+        break;
+      }
+      bytes += rect.width() * rect.height() * bytes_per_pixel_;
+    }
+    if (still_solid) {
+      stats.bytes_skipped += bytes;
+      return stats;
+    }
+    solid_ = false;
+    spans_changed = true;
+    new_damage = Region(bounds);
+  }
+  pending_damage_.Union(new_damage);
+  if (pending_damage_.is_empty())
+    return stats;
+
+  // Pixel scans work on 32-bit RGB pixels.
+  if (!solid_ && bytes_per_pixel_ == 4 &&
+      shm_format_->yuv == YuvFormat::kNone) {
+    // Only damage covering the whole buffer can turn it into a solid fill,
+    // anything less would need the texture for the rest.
+    Region uncovered(bounds);
+    uncovered.Subtract(pending_damage_);
+    if (uncovered.is_empty() &&
+        FindUniformColor(data, stride, bounds, &solid_color_)) {
+      solid_ = true;
+      ReleaseTexture();
+      if (needs_backdrop_ || IsOpaque(solid_color_))
+        opaque_region_ = Region(bounds);
+      else
+        opaque_region_ = Region::Empty();
+      pending_damage_.Clear();
+      stats.bytes_skipped += width_ * height_ * bytes_per_pixel_;
+      return stats;
+    }
+  }
+
+  // Content that is not visible stays pending until it is.
+  Region to_upload = pending_damage_.Clone();
+  Region buffer_visible = viewport_.ViewToBuffer(visible);
+  to_upload.Intersect(buffer_visible);
+  if (to_upload.is_empty())
+    return stats;
+  pending_damage_.Subtract(to_upload);
+  auto rectangles = to_upload.rectangles();
+
+  if (!planes_[0])
+    AllocateTexture();
+
+  // Horizontal extent [first, second) of the damage within each band.
+  std::vector<std::pair<int32_t, int32_t>> extents(bands_.size(),
+                                                   std::make_pair(width_, 0));
+  for (auto& rect : rectangles) {
+    int32_t last_band = (rect.y() + rect.height() - 1) / kBandHeight;
+    for (int32_t b = rect.y() / kBandHeight; b <= last_band; b++) {
+      extents[b].first = std::min(extents[b].first, rect.x());
+      extents[b].second = std::max(extents[b].second, rect.x() + rect.width());
+    }
+  }
+
+  // Where each plane starts in the buffer, and its stride.
+  uint8_t* plane_data[kMaxShmPlanes];
+  int32_t plane_strides[kMaxShmPlanes];
+  for (int32_t i = 0; i < shm_format_->plane_count; i++) {
+    plane_data[i] = static_cast<uint8_t*>(data) +
+                    ShmPlaneOffset(*shm_format_, i, stride, height_,
+                                   &plane_strides[i]);
+  }
+
+  for (size_t b = 0; b < bands_.size(); b++) {
+    int32_t x0 = extents[b].first;
+    int32_t x1 = extents[b].second;
+    if (x0 >= x1)
+      continue;
+    int32_t y = b * kBandHeight;
+    int32_t rows = std::min(kBandHeight, height_ - y);
+
+    // Only a band uploaded over its full width is known to match the buffer,
+    // so only those bands can be skipped later on.
+    if (x0 == 0 && x1 == width_) {
+      uint32_t hash = 0;
+      uint64_t bytes = 0;
+      for (int32_t i = 0; i < shm_format_->plane_count; i++) {
+        auto& plane = shm_format_->planes[i];
+        int32_t py = y / plane.vertical_subsampling;
+        int32_t prows = PlaneSize(y + rows, plane.vertical_subsampling) - py;
+        int32_t row_bytes = PlaneSize(width_, plane.horizontal_subsampling) *
+                            plane.bytes_per_texel;
+        hash = HashBand(hash, plane_data[i] + py * plane_strides[i],
+                        row_bytes, prows, plane_strides[i]);
+        bytes += prows * row_bytes;
+      }
+      if (bands_[b].valid && bands_[b].hash == hash) {
+        stats.bytes_skipped += bytes;
+        continue;
+      }
+      bands_[b].hash = hash;
+      bands_[b].valid = true;
+    } else {
+      bands_[b].valid = false;
+    }
+
+    if (!needs_backdrop_ && ScanBand(b, plane_data[0], stride))
+      spans_changed = true;
+
+    for (int32_t i = 0; i < shm_format_->plane_count; i++) {
+      auto& plane = shm_format_->planes[i];
+      // Subsampled planes are updated over every texel the damage touches.
+      int32_t px0 = x0 / plane.horizontal_subsampling;
+      int32_t px1 = PlaneSize(x1, plane.horizontal_subsampling);
+      int32_t py = y / plane.vertical_subsampling;
+      int32_t prows = PlaneSize(y + rows, plane.vertical_subsampling) - py;
+      renderer_->BindTexture(planes_[i]);
+      // Rows are uploaded straight from the buffer, padding and all.
+      glPixelStorei(GL_UNPACK_ROW_LENGTH,
+                    plane_strides[i] / plane.bytes_per_texel);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, plane_strides[i] % 4 ? 1 : 4);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, px0, py, px1 - px0, prows,
+                      plane.pixel_format, plane.type,
+                      plane_data[i] + py * plane_strides[i] +
+                          px0 * plane.bytes_per_texel);
+      stats.bytes_uploaded += prows * (px1 - px0) * plane.bytes_per_texel;
+    }
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  if (spans_changed)
+    UpdateOpaqueRegion();
+  return stats;
+}
+
+Region Texture::OpaqueRegion() {
+  // Pending content has not been scanned yet.
+  Region result = opaque_region_.Clone();
+  result.Subtract(pending_damage_);
+  return viewport_.BufferToView(result, true);
+}
+
+bool Texture::HasPendingDamage() {
+  return !pending_damage_.is_empty();
+}
+
+uint64_t Texture::MemorySize() {
+  if (!planes_[0])
+    return 0;
+  uint64_t size = 0;
+  for (int32_t i = 0; i < shm_format_->plane_count; i++) {
+    auto& plane = shm_format_->planes[i];
+    uint64_t texels = PlaneSize(width_, plane.horizontal_subsampling);
+    texels *= PlaneSize(height_, plane.vertical_subsampling);
+    size += texels * plane.bytes_per_texel;
+  }
+  return size;
+}
+
+void Texture::DrawSolid(int x, int y, const base::geometry::Rect& patch) {
+  GLint vertices[] = {x + patch.x(),
+                      y + patch.y() + patch.height(),
+                      x + patch.x(),
+                      y + patch.y(),
+                      x + patch.x() + patch.width(),
+                      y + patch.y(),
+                      x + patch.x() + patch.width(),
+                      y + patch.y() + patch.height()};
+  float r = ((solid_color_ >> 16) & 0xff) / 255.0f;
+  float g = ((solid_color_ >> 8) & 0xff) / 255.0f;
+  float b = (solid_color_ & 0xff) / 255.0f;
+  if (!shm_format_->bgra)
+    std::swap(r, b);
+  float a = needs_backdrop_ ? 1.0f : (solid_color_ >> 24) / 255.0f;
+  renderer_->DrawSolidQuad(vertices, r, g, b, a, true);
+}
+
+void Texture::DrawPatch(int x, int y, const base::geometry::Rect& patch) {
+  GLint vertices[] = {x + patch.x(),
+                      y + patch.y() + patch.height(),
+                      x + patch.x(),
+                      y + patch.y(),
+                      x + patch.x() + patch.width(),
+                      y + patch.y(),
+                      x + patch.x() + patch.width(),
+                      y + patch.y() + patch.height()};
+  // Each corner is mapped on its own, as buffer transforms permute them.
+  GLfloat tex_coords[8];
+  for (int32_t i = 0; i < 4; i++) {
+    viewport_.ViewToBuffer(vertices[i * 2] - x, vertices[i * 2 + 1] - y,
+                           &tex_coords[i * 2], &tex_coords[i * 2 + 1]);
+    tex_coords[i * 2] /= width_;
+    tex_coords[i * 2 + 1] /= height_;
+  }
+
+  TRACE("Texture coord: tl (%f %f), br (%f %f)", tex_coords[2], tex_coords[3],
+        tex_coords[6], tex_coords[7]);
+
+  // Imported dmabufs carry their format, the GPU samples them as RGBA.
+  if (imported_)
+    renderer_->DrawTextureQuad(vertices, tex_coords, imported_, false);
+  else if (shm_format_->yuv != YuvFormat::kNone)
+    renderer_->DrawYuvQuad(vertices, tex_coords, planes_, shm_format_->yuv);
+  else
+    renderer_->DrawTextureQuad(vertices, tex_coords, planes_[0], swizzle_);
+}
+
+void Texture::DrawRegion(int x, int y, Region& region) {
+  for (auto& rect : region.rectangles()) {
+    if (solid_)
+      DrawSolid(x, y, rect);
+    else
+      DrawPatch(x, y, rect);
+  }
+}
+
+void Texture::Draw(int x,
+                   int y,
+                   int patch_x,
+                   int patch_y,
+                   int width,
+                   int height,
+                   DrawPass pass) {
+  TRACE(
+      "Draw: offset (%d %d) (in buffer offset: %d %d) (dimension: %d %d), "
+      "texture dimension: (%d %d)",
+      x, y, patch_x, patch_y, width, height, width_, height_);
+  if (!planes_[0] && !solid_ && !imported_)
+    return;
+
+  if (width_ == 0)
+    width_ = 1;
+  if (height_ == 0)
+    height_ = 1;
+  int32_t view_width = viewport_.width();
+  int32_t view_height = viewport_.height();
+  if (width > view_width)
+    width = view_width;
+  if (height > view_height)
+    height = view_height;
+
+  // Views may be larger than their buffer, only the buffer part is drawn.
+  Region area(base::geometry::Rect(patch_x, patch_y, width, height));
+  area.Intersect(base::geometry::Rect(0, 0, view_width, view_height));
+
+  // Opaque content needs no blending, which saves reading back the frame
+  // buffer for most of a typical window.
+  Region opaque = Region::Empty();
+  if (needs_backdrop_ || (solid_ && IsOpaque(solid_color_)))
+    opaque = area.Clone();
+  else if (!solid_)
+    opaque = viewport_.BufferToView(opaque_region_, true);
+  opaque.Intersect(area);
+  area.Subtract(opaque);
+
+  switch (pass) {
+    case DrawPass::kOpaque:
+      DrawRegion(x, y, opaque);
+      break;
+    case DrawPass::kTranslucent:
+      DrawRegion(x, y, area);
+      break;
+    case DrawPass::kAll:
+      if (!opaque.is_empty()) {
+        renderer_->SetBlend(false);
+        DrawRegion(x, y, opaque);
+        renderer_->SetBlend(true);
+      }
+      DrawRegion(x, y, area);
+      break;
+  }
+}
+
+}  // namespace compositor
+}  // namespace naive
@@ -0,0 +1,114 @@
+#ifndef COMPOSITOR_TEXTURE_H_
+#define COMPOSITOR_TEXTURE_H_
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <vector>
+
+#include "compositor/shm_format.h"
+#include "compositor/texture_delegate.h"
+
+namespace naive {
+namespace compositor {
+
+class GlRenderer;
+
+// A GL texture holding the content of a client buffer. The texture is kept
+// across commits and only damaged content is uploaded. Content is uploaded in
+// row bands; a band whose hash matches the last uploaded content is skipped.
+// A buffer of one uniform color is drawn as a solid fill and has no GL
+// texture at all. Uploaded bands are scanned for alpha to infer which part of
+// the buffer is opaque; that part is drawn with blending disabled. Damage
+// outside the visible part of the buffer is kept pending and uploaded once it
+// becomes visible. Buffers are uploaded in their own format, with padded
+// rows as they are, and converted by the GPU; YUV planes go into textures of
+// their own and are converted while drawing. A viewport crops and scales the
+// buffer through texture coordinates, sampled with linear filtering, and
+// buffer transforms permute them. Buffers in shm pools that can be wrapped as
+// dmabufs are imported instead and sampled where they are, without any copy;
+// the last few imports are kept for clients cycling through buffers.
+class Texture : public TextureDelegate {
+ public:
+  explicit Texture(GlRenderer* renderer);
+  ~Texture() override;
+
+  // TextureDelegate overrides.
+  void Draw(int x,
+            int y,
+            int patch_x,
+            int patch_y,
+            int width,
+            int height,
+            DrawPass pass) override;
+  UploadStats Update(DrawQuad& quad, Region& damage, Region& visible) override;
+  Region OpaqueRegion() override;
+  void SetViewport(const BufferViewport& viewport) override;
+  bool HasPendingDamage() override;
+  uint64_t MemorySize() override;
+
+ private:
+  struct Band {
+    uint32_t hash = 0;
+    bool valid = false;
+    // Columns [opaque_start, opaque_end) are opaque in every row.
+    int32_t opaque_start = 0;
+    int32_t opaque_end = 0;
+  };
+
+  struct Import {
+    uint32_t dmabuf_id;
+    int32_t offset;
+    int32_t stride;
+    // EGL_NO_IMAGE_KHR and 0 if the import failed, so the buffer is copied.
+    EGLImageKHR image;
+    GLuint texture;
+  };
+
+  // Resets the texture to describe a buffer of the given size and format.
+  void Reset(int32_t width, int32_t height, int32_t format);
+  void AllocateTexture();
+  void ReleaseTexture();
+  // Picks the filter for the viewport and applies it to allocated planes.
+  void UpdateFilter();
+  // Returns the texture the dmabuf of |quad| is imported into, or 0 if it has
+  // to be copied.
+  GLuint ImportDmaBuf(DrawQuad& quad);
+  void ReleaseImports();
+  // Scans band |b| for its opaque span, returns whether the span changed.
+  bool ScanBand(size_t b, const uint8_t* data, int32_t stride);
+  void UpdateOpaqueRegion();
+  void DrawSolid(int x, int y, const base::geometry::Rect& patch);
+  void DrawPatch(int x, int y, const base::geometry::Rect& patch);
+  void DrawRegion(int x, int y, Region& region);
+
+  GlRenderer* renderer_;
+  // One texture per plane of the format.
+  GLuint planes_[kMaxShmPlanes] = {};
+  // Imported dmabufs, most recently used first.
+  std::vector<Import> imports_;
+  // Texture of the import drawn from, 0 when drawing from |planes_|.
+  GLuint imported_ = 0;
+  int32_t width_ = 0, height_ = 0;
+  int32_t format_ = 0;
+  const ShmFormat* shm_format_ = nullptr;
+  int32_t bytes_per_pixel_ = 4;
+  // Whether the shader swaps red and blue, for BGRA content uploaded as RGBA.
+  bool swizzle_{true};
+  bool needs_backdrop_{false};
+  bool solid_{false};
+  bool linear_{false};
+  BufferViewport viewport_;
+  uint32_t solid_color_ = 0;
+  // Part of the buffer known to be opaque, in buffer coordinates.
+  Region opaque_region_ = Region::Empty();
+  // Damaged content not uploaded yet, in buffer coordinates.
+  Region pending_damage_ = Region::Empty();
+  std::vector<Band> bands_;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_TEXTURE_H_
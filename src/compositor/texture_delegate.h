@@ -1,19 +1,69 @@
 #ifndef COMPOSITOR_TEXTUREDELEGATE_H_
 #define COMPOSITOR_TEXTUREDELEGATE_H_
 
+#include <cstdint>
 #include <memory>
 
+#include "compositor/buffer_viewport.h"
+#include "compositor/draw_quad.h"
+#include "compositor/region.h"
+
 namespace naive {
 namespace compositor {
 
+// Bytes of buffer content that were uploaded to, or found to be already
+// present in, a texture.
+struct UploadStats {
+  uint64_t bytes_uploaded = 0;
+  uint64_t bytes_skipped = 0;
+  // Damaged content sampled from client memory in place instead of uploaded.
+  uint64_t bytes_imported = 0;
+
+  UploadStats& operator+=(const UploadStats& other) {
+    bytes_uploaded += other.bytes_uploaded;
+    bytes_skipped += other.bytes_skipped;
+    bytes_imported += other.bytes_imported;
+    return *this;
+  }
+};
+
+// Part of a texture to draw. Frames are drawn in two passes, the opaque parts
+// of all views with blending disabled, then the translucent parts with
+// blending enabled, so blend state changes twice per frame.
+enum class DrawPass {
+  // Everything; blending is switched off for opaque parts and back on.
+  kAll,
+  // Opaque parts only. Blend state is left to the caller.
+  kOpaque,
+  // Translucent parts only. Blend state is left to the caller.
+  kTranslucent,
+};
+
 class TextureDelegate {
  public:
+  // Draws the part of the view at (x, y) given by the patch, in view
+  // coordinates.
   virtual void Draw(int x,
                     int y,
                     int patch_x,
                     int patch_y,
                     int width,
-                    int height) = 0;
+                    int height,
+                    DrawPass pass) = 0;
+  // Updates the texture from |quad|. Only |damage| that falls in |visible| is
+  // uploaded, the rest is kept for later updates. |damage| is in buffer
+  // coordinates, |visible| in view coordinates relative to the view.
+  virtual UploadStats Update(DrawQuad& quad,
+                             Region& damage,
+                             Region& visible) = 0;
+  // Returns the part of the texture known to be opaque, in view coordinates.
+  virtual Region OpaqueRegion() = 0;
+  // Sets how the buffer maps onto the view.
+  virtual void SetViewport(const BufferViewport& viewport) = 0;
+  // Whether damaged content is waiting to be uploaded.
+  virtual bool HasPendingDamage() = 0;
+  // Returns the GPU memory held by the texture, in bytes.
+  virtual uint64_t MemorySize() = 0;
   virtual ~TextureDelegate() = default;
 };
 
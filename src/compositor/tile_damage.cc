@@ -0,0 +1,187 @@
+#include "compositor/tile_damage.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <algorithm>
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+constexpr int32_t kBitsPerWord = 64;
+
+// Returns a word with bits [begin, end) set, 0 <= begin < end <= 64.
+uint64_t BitRange(int32_t begin, int32_t end) {
+  uint64_t high = end == kBitsPerWord ? ~0ull : (1ull << end) - 1;
+  return high & ~((1ull << begin) - 1);
+}
+
+}  // namespace
+
+TileSet::TileSet(int32_t columns, int32_t rows)
+    : columns_(columns),
+      rows_(rows),
+      words_per_row_((columns + kBitsPerWord - 1) / kBitsPerWord) {
+  // Keep an even number of words so SSE2 can process them in pairs.
+  size_t words = words_per_row_ * rows_;
+  words_.assign(words + (words & 1), 0);
+}
+
+void TileSet::Set(int32_t column, int32_t row, int32_t width, int32_t height) {
+  int32_t column_end = std::min(column + width, columns_);
+  int32_t row_end = std::min(row + height, rows_);
+  column = std::max(column, 0);
+  row = std::max(row, 0);
+  if (column >= column_end || row >= row_end)
+    return;
+
+  int32_t first_word = column / kBitsPerWord;
+  int32_t last_word = (column_end - 1) / kBitsPerWord;
+  for (int32_t r = row; r < row_end; r++) {
+    uint64_t* words = words_.data() + r * words_per_row_;
+    for (int32_t w = first_word; w <= last_word; w++) {
+      int32_t begin = std::max(column - w * kBitsPerWord, 0);
+      int32_t end = std::min(column_end - w * kBitsPerWord, kBitsPerWord);
+      words[w] |= BitRange(begin, end);
+    }
+  }
+}
+
+void TileSet::SetAll() {
+  Clear();
+  Set(0, 0, columns_, rows_);
+}
+
+void TileSet::Clear() {
+  std::fill(words_.begin(), words_.end(), 0);
+}
+
+bool TileSet::IsEmpty() const {
+  for (uint64_t word : words_) {
+    if (word)
+      return false;
+  }
+  return true;
+}
+
+void TileSet::Union(const TileSet& other) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 2 <= words_.size(); i += 2) {
+    __m128i* dst = reinterpret_cast<__m128i*>(words_.data() + i);
+    __m128i src =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&other.words_[i]));
+    _mm_storeu_si128(dst, _mm_or_si128(_mm_loadu_si128(dst), src));
+  }
+#endif
+  for (; i < words_.size(); i++)
+    words_[i] |= other.words_[i];
+}
+
+void TileSet::Intersect(const TileSet& other) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 2 <= words_.size(); i += 2) {
+    __m128i* dst = reinterpret_cast<__m128i*>(words_.data() + i);
+    __m128i src =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&other.words_[i]));
+    _mm_storeu_si128(dst, _mm_and_si128(_mm_loadu_si128(dst), src));
+  }
+#endif
+  for (; i < words_.size(); i++)
+    words_[i] &= other.words_[i];
+}
+
+// static
+constexpr int32_t TileDamage::kTileSize;
+// static
+constexpr int32_t TileDamage::kMaxAge;
+
+TileDamage::TileDamage(int32_t width, int32_t height)
+    : width_(width),
+      height_(height),
+      columns_((width + kTileSize - 1) / kTileSize),
+      rows_((height + kTileSize - 1) / kTileSize),
+      history_(kMaxAge, TileSet(columns_, rows_)) {}
+
+void TileDamage::Add(const base::geometry::Rect& rect) {
+  if (rect.width() <= 0 || rect.height() <= 0)
+    return;
+  int32_t column = std::max(rect.x(), 0) / kTileSize;
+  int32_t row = std::max(rect.y(), 0) / kTileSize;
+  int32_t column_end = (rect.x() + rect.width() + kTileSize - 1) / kTileSize;
+  int32_t row_end = (rect.y() + rect.height() + kTileSize - 1) / kTileSize;
+  current().Set(column, row, column_end - column, row_end - row);
+}
+
+void TileDamage::AddAll() {
+  current().SetAll();
+}
+
+TileSet TileDamage::Accumulate(int32_t age) {
+  TileSet result(columns_, rows_);
+  if (age <= 0 || age > frames_) {
+    result.SetAll();
+    return result;
+  }
+  for (int32_t i = 0; i < age; i++)
+    result.Union(history_[(current_ - i + kMaxAge) % kMaxAge]);
+  return result;
+}
+
+std::vector<base::geometry::Rect> TileDamage::ToRects(const TileSet& tiles) {
+  std::vector<base::geometry::Rect> result;
+  // Indices into |result| of the runs found in the previous row, which may
+  // still grow downwards.
+  std::vector<size_t> open, next_open;
+  for (int32_t row = 0; row < rows_; row++) {
+    const uint64_t* words = tiles.row_words(row);
+    next_open.clear();
+    size_t candidate = 0;
+    int32_t column = 0;
+    while (column < columns_) {
+      // Find the next run of set bits [begin, end).
+      uint64_t word = words[column / kBitsPerWord] >>
+                      (column % kBitsPerWord);
+      if (!word) {
+        column = (column / kBitsPerWord + 1) * kBitsPerWord;
+        continue;
+      }
+      int32_t begin = column + __builtin_ctzll(word);
+      int32_t end = begin;
+      while (end < columns_ &&
+             (words[end / kBitsPerWord] >> (end % kBitsPerWord)) & 1) {
+        end++;
+      }
+      column = end;
+
+      int32_t x = begin * kTileSize;
+      int32_t width = std::min(end * kTileSize, width_) - x;
+      int32_t y = row * kTileSize;
+      int32_t height = std::min(y + kTileSize, height_) - y;
+      while (candidate < open.size() && result[open[candidate]].x() < x)
+        candidate++;
+      if (candidate < open.size() && result[open[candidate]].x() == x &&
+          result[open[candidate]].width() == width) {
+        result[open[candidate]].height_ += height;
+        next_open.push_back(open[candidate]);
+      } else {
+        result.push_back(base::geometry::Rect(x, y, width, height));
+        next_open.push_back(result.size() - 1);
+      }
+    }
+    open.swap(next_open);
+  }
+  return result;
+}
+
+void TileDamage::NextFrame() {
+  current_ = (current_ + 1) % kMaxAge;
+  current().Clear();
+  frames_ = std::min(frames_ + 1, kMaxAge);
+}
+
+}  // namespace compositor
+}  // namespace naive
@@ -0,0 +1,80 @@
+#ifndef COMPOSITOR_TILE_DAMAGE_H_
+#define COMPOSITOR_TILE_DAMAGE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "base/geometry.h"
+
+namespace naive {
+namespace compositor {
+
+// A set of tiles on a grid, stored as one bit per tile. Each tile row starts
+// at a new 64-bit word.
+class TileSet {
+ public:
+  TileSet(int32_t columns, int32_t rows);
+
+  // Marks tiles [column, column + width) x [row, row + height).
+  void Set(int32_t column, int32_t row, int32_t width, int32_t height);
+  void SetAll();
+  void Clear();
+  bool IsEmpty() const;
+
+  void Union(const TileSet& other);
+  void Intersect(const TileSet& other);
+
+  int32_t columns() const { return columns_; }
+  int32_t rows() const { return rows_; }
+  const uint64_t* row_words(int32_t row) const {
+    return words_.data() + row * words_per_row_;
+  }
+
+ private:
+  int32_t columns_, rows_;
+  int32_t words_per_row_;
+  std::vector<uint64_t> words_;
+};
+
+// Damage of an output, tracked as tiles of kTileSize x kTileSize pixels.
+// Adding a rectangle only sets bits, so many small damage rectangles cost no
+// more than a few large ones. The damage of the last kMaxAge frames is kept,
+// so a back buffer of any age up to that is brought up to date by copying
+// only what changed since it was shown.
+class TileDamage {
+ public:
+  static constexpr int32_t kTileSize = 64;
+  static constexpr int32_t kMaxAge = 4;
+
+  TileDamage(int32_t width, int32_t height);
+
+  // Adds damage to the current frame.
+  void Add(const base::geometry::Rect& rect);
+  void AddAll();
+
+  // Returns the tiles damaged in the current frame and the |age| - 1 frames
+  // before it. An unknown or too old age damages everything.
+  TileSet Accumulate(int32_t age);
+
+  // Converts |tiles| into rectangles clipped to the output. Horizontal runs of
+  // tiles are merged with identical runs in the rows below.
+  std::vector<base::geometry::Rect> ToRects(const TileSet& tiles);
+
+  // Finishes the current frame and starts a new one.
+  void NextFrame();
+
+ private:
+  TileSet& current() { return history_[current_]; }
+
+  int32_t width_, height_;
+  int32_t columns_, rows_;
+  std::vector<TileSet> history_;
+  int32_t current_ = 0;
+  // Number of frames recorded in |history_|, including the current one.
+  int32_t frames_ = 1;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_TILE_DAMAGE_H_
@@ -0,0 +1,33 @@
+#include "compositor/viewport.h"
+
+namespace naive {
+
+Viewport::Viewport(Surface* surface) : surface_(surface) {
+  TRACE("%p, surface: %p", this, surface);
+  surface_->AddSurfaceObserver(this);
+}
+
+Viewport::~Viewport() {
+  TRACE("%p, surface: %p", this, surface_);
+  if (!surface_)
+    return;
+  surface_->SetViewportSource(0, 0, -1, -1);
+  surface_->SetViewportDestination(-1, -1);
+  surface_->set_viewport_resource(nullptr);
+  surface_->RemoveSurfaceObserver(this);
+}
+
+void Viewport::SetSource(float x, float y, float width, float height) {
+  surface_->SetViewportSource(x, y, width, height);
+}
+
+void Viewport::SetDestination(int32_t width, int32_t height) {
+  surface_->SetViewportDestination(width, height);
+}
+
+void Viewport::OnSurfaceDestroyed(Surface* surface) {
+  if (surface == surface_)
+    surface_ = nullptr;
+}
+
+}  // namespace naive
@@ -0,0 +1,34 @@
+#ifndef COMPOSITOR_VIEWPORT_H_
+#define COMPOSITOR_VIEWPORT_H_
+
+#include <cstdint>
+
+#include "compositor/surface.h"
+
+namespace naive {
+
+// Crops and scales the buffer of a surface, as set through wp_viewport. The
+// crop and scale are surface state and take effect on the next commit; they
+// are unset again once the viewport goes away.
+class Viewport : public SurfaceObserver {
+ public:
+  explicit Viewport(Surface* surface);
+  ~Viewport();
+
+  // Both are in surface coordinates, a width of -1 unsets them.
+  void SetSource(float x, float y, float width, float height);
+  void SetDestination(int32_t width, int32_t height);
+
+  // The surface, or null once it is destroyed.
+  Surface* surface() { return surface_; }
+
+  // SurfaceObserver overrides
+  void OnSurfaceDestroyed(Surface* surface) override;
+
+ private:
+  Surface* surface_;
+};
+
+}  // namespace naive
+
+#endif  // COMPOSITOR_VIEWPORT_H_
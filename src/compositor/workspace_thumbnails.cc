@@ -0,0 +1,219 @@
+#include "compositor/workspace_thumbnails.h"
+
+#include <GLES3/gl3ext.h>
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/time.h"
+#include "compositor/compositor_view.h"
+#include "compositor/gl_renderer.h"
+#include "compositor/region.h"
+#include "compositor/texture_delegate.h"
+#include "wm/window_impl.h"
+
+namespace naive {
+namespace compositor {
+
+namespace {
+
+// Thumbnails are rendered at this many times their slot size and mipmapped
+// down from there.
+constexpr int32_t kSupersample = 4;
+constexpr uint32_t kRefreshIntervalMs = 500;
+
+}  // namespace
+
+WorkspaceThumbnails::WorkspaceThumbnails(GlRenderer* renderer,
+                                         int32_t screen_width,
+                                         int32_t screen_height)
+    : renderer_(renderer),
+      screen_width_(screen_width),
+      screen_height_(screen_height) {}
+
+WorkspaceThumbnails::~WorkspaceThumbnails() {
+  for (auto& thumbnail : thumbnails_)
+    Release(&thumbnail);
+}
+
+void WorkspaceThumbnails::SetSlots(
+    const std::vector<base::geometry::Rect>& slots) {
+  if (thumbnails_.size() < slots.size())
+    thumbnails_.resize(slots.size());
+  for (size_t i = 0; i < slots.size(); i++) {
+    thumbnails_[i].slot = slots[i];
+    thumbnails_[i].dirty = true;
+  }
+}
+
+void WorkspaceThumbnails::SetWindows(size_t workspace,
+                                     const std::vector<wm::Window*>& windows) {
+  if (thumbnails_.size() <= workspace)
+    thumbnails_.resize(workspace + 1);
+  auto& thumbnail = thumbnails_[workspace];
+  if (thumbnail.windows == windows)
+    return;
+  thumbnail.windows = windows;
+  thumbnail.dirty = true;
+}
+
+void WorkspaceThumbnails::OnWindowChanged(wm::Window* window) {
+  for (auto& thumbnail : thumbnails_) {
+    if (std::find(thumbnail.windows.begin(), thumbnail.windows.end(),
+                  window) != thumbnail.windows.end())
+      thumbnail.dirty = true;
+  }
+}
+
+void WorkspaceThumbnails::OnWindowDestroyed(wm::Window* window) {
+  for (auto& thumbnail : thumbnails_) {
+    auto iter =
+        std::find(thumbnail.windows.begin(), thumbnail.windows.end(), window);
+    if (iter == thumbnail.windows.end())
+      continue;
+    thumbnail.windows.erase(iter);
+    thumbnail.dirty = true;
+  }
+}
+
+bool WorkspaceThumbnails::NeedsRefresh() {
+  if (base::Time::CurrentTimeMilliSeconds() - last_refresh_ms_ <
+      kRefreshIntervalMs)
+    return false;
+  for (auto& thumbnail : thumbnails_) {
+    if (thumbnail.dirty && !thumbnail.slot.Empty())
+      return true;
+  }
+  return false;
+}
+
+void WorkspaceThumbnails::Refresh(int32_t scale) {
+  last_refresh_ms_ = base::Time::CurrentTimeMilliSeconds();
+  refreshed_slots_.clear();
+  for (auto& thumbnail : thumbnails_) {
+    if (!thumbnail.dirty || thumbnail.slot.Empty())
+      continue;
+    Render(&thumbnail, scale);
+    thumbnail.dirty = false;
+    refreshed_slots_.push_back(thumbnail.slot);
+  }
+}
+
+void WorkspaceThumbnails::Render(Thumbnail* thumbnail, int32_t scale) {
+  if (thumbnail->width != thumbnail->slot.width() * kSupersample ||
+      thumbnail->height != thumbnail->slot.height() * kSupersample)
+    Allocate(thumbnail);
+  if (!thumbnail->framebuffer)
+    return;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, thumbnail->framebuffer);
+  renderer_->SetProjection(
+      base::geometry::Rect(0, 0, screen_width_, screen_height_),
+      thumbnail->width, thumbnail->height);
+  glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  for (auto* window : thumbnail->windows) {
+    // Only textures already present are drawn, a window without one is left
+    // out rather than uploaded.
+    auto views =
+        CompositorView::BuildCompositorViewHierarchyRecursive(window, scale);
+    for (auto& view : views) {
+      auto* texture = view->window()->window_impl()->CachedTexture();
+      if (!texture)
+        continue;
+      auto bounds = view->global_bounds();
+      for (auto& rect : view->draw_region().rectangles()) {
+        texture->Draw(bounds.x(), bounds.y(), rect.x() - bounds.x(),
+                      rect.y() - bounds.y(), rect.width(), rect.height(),
+                      DrawPass::kAll);
+      }
+    }
+  }
+  renderer_->ResetProjection();
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  renderer_->BindTexture(thumbnail->texture);
+  glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void WorkspaceThumbnails::Draw(const std::vector<base::geometry::Rect>& rects) {
+  Region clip = Region::Empty();
+  for (auto& rect : rects)
+    clip.Union(rect);
+  // Thumbnails are opaque, but hold undefined alpha where XRGB content was
+  // drawn.
+  renderer_->SetBlend(false);
+  for (auto& thumbnail : thumbnails_) {
+    if (!thumbnail.texture)
+      continue;
+    auto& slot = thumbnail.slot;
+    Region area = clip.Clone();
+    area.Intersect(slot);
+    for (auto& rect : area.rectangles()) {
+      GLint vertices[] = {rect.x(),
+                          rect.y() + rect.height(),
+                          rect.x(),
+                          rect.y(),
+                          rect.x() + rect.width(),
+                          rect.y(),
+                          rect.x() + rect.width(),
+                          rect.y() + rect.height()};
+      // The thumbnail was rendered with the top of the screen in its last
+      // row.
+      float left = (float)(rect.x() - slot.x()) / slot.width();
+      float right = (float)(rect.x() + rect.width() - slot.x()) / slot.width();
+      float top = 1.0f - (float)(rect.y() - slot.y()) / slot.height();
+      float bottom =
+          1.0f - (float)(rect.y() + rect.height() - slot.y()) / slot.height();
+      GLfloat tex_coords[] = {
+          left, bottom, left, top, right, top, right, bottom,
+      };
+      renderer_->DrawTextureQuad(vertices, tex_coords, thumbnail.texture,
+                                 false);
+    }
+  }
+  renderer_->SetBlend(true);
+}
+
+void WorkspaceThumbnails::Allocate(Thumbnail* thumbnail) {
+  Release(thumbnail);
+  int32_t width = thumbnail->slot.width() * kSupersample;
+  int32_t height = thumbnail->slot.height() * kSupersample;
+  int32_t levels = 1;
+  while ((width >> levels) > 0 || (height >> levels) > 0)
+    levels++;
+
+  glGenTextures(1, &thumbnail->texture);
+  renderer_->BindTexture(thumbnail->texture);
+  glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glGenFramebuffers(1, &thumbnail->framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, thumbnail->framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         thumbnail->texture, 0);
+  bool complete =
+      glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (!complete) {
+    LOG_ERROR << "workspace thumbnail frame buffer incomplete";
+    Release(thumbnail);
+    return;
+  }
+  thumbnail->width = width;
+  thumbnail->height = height;
+}
+
+void WorkspaceThumbnails::Release(Thumbnail* thumbnail) {
+  if (thumbnail->framebuffer)
+    glDeleteFramebuffers(1, &thumbnail->framebuffer);
+  renderer_->DeleteTexture(&thumbnail->texture);
+  thumbnail->framebuffer = 0;
+  thumbnail->width = thumbnail->height = 0;
+}
+
+}  // namespace compositor
+}  // namespace naive
@@ -0,0 +1,79 @@
+#ifndef COMPOSITOR_WORKSPACE_THUMBNAILS_H_
+#define COMPOSITOR_WORKSPACE_THUMBNAILS_H_
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <vector>
+
+#include "base/geometry.h"
+
+namespace naive {
+namespace wm {
+class Window;
+}  // namespace wm
+
+namespace compositor {
+
+class GlRenderer;
+
+// Small pictures of each workspace, drawn over the panel. A thumbnail is
+// rendered from the textures its windows already have into a mipmapped frame
+// buffer a few times the size of its slot, so it is downsampled on the GPU
+// without clients repainting or anything being uploaded. Thumbnails are only
+// rendered again once windows of their workspace changed, and at most every
+// kRefreshIntervalMs.
+//
+// Windows of hidden workspaces are drawn from the last texture they had
+// while shown, as their commits are not uploaded; one whose texture was
+// evicted is left out. Their commits still mark the thumbnail changed.
+class WorkspaceThumbnails {
+ public:
+  WorkspaceThumbnails(GlRenderer* renderer,
+                      int32_t screen_width,
+                      int32_t screen_height);
+  ~WorkspaceThumbnails();
+
+  // Sets where each workspace is drawn, in global coordinates.
+  void SetSlots(const std::vector<base::geometry::Rect>& slots);
+  // Sets the top-level windows of |workspace|, bottom to top.
+  void SetWindows(size_t workspace, const std::vector<wm::Window*>& windows);
+  // Marks the workspace holding the top-level |window| as changed.
+  void OnWindowChanged(wm::Window* window);
+  void OnWindowDestroyed(wm::Window* window);
+
+  // Whether changed thumbnails are due to be rendered again.
+  bool NeedsRefresh();
+  // Renders the changed thumbnails. |scale| is the output scale.
+  void Refresh(int32_t scale);
+  // Draws the part of the thumbnails inside |rects|.
+  void Draw(const std::vector<base::geometry::Rect>& rects);
+  // Slots of the thumbnails rendered by the last Refresh().
+  const std::vector<base::geometry::Rect>& refreshed_slots() {
+    return refreshed_slots_;
+  }
+
+ private:
+  struct Thumbnail {
+    base::geometry::Rect slot;
+    std::vector<wm::Window*> windows;
+    bool dirty = true;
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    int32_t width = 0, height = 0;
+  };
+
+  void Render(Thumbnail* thumbnail, int32_t scale);
+  void Allocate(Thumbnail* thumbnail);
+  void Release(Thumbnail* thumbnail);
+
+  GlRenderer* renderer_;
+  int32_t screen_width_, screen_height_;
+  std::vector<Thumbnail> thumbnails_;
+  std::vector<base::geometry::Rect> refreshed_slots_;
+  uint32_t last_refresh_ms_ = 0;
+};
+
+}  // namespace compositor
+}  // namespace naive
+
+#endif  // COMPOSITOR_WORKSPACE_THUMBNAILS_H_
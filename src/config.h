@@ -62,6 +62,17 @@ const std::string kLayouts[] = {
     kLayoutEqSplit, kLayoutEqSplit, kLayoutEqSplit,
     kLayoutEqSplit, kLayoutEqSplit, kLayoutFullscreen};
 
+////////////////////////////////////////////////////////////////////////////////
+// Compositor configurations.
+// Textures of windows on hidden workspaces are kept, so switching back needs
+// no uploads. Past this many bytes, textures of the windows hidden the longest
+// are released.
+constexpr uint64_t kHiddenTextureBudgetBytes = 256 * 1024 * 1024;
+// Linked shader programs are kept here, so later starts skip compiling them.
+// Leave it empty to use $XDG_CACHE_HOME/naive-wm/shaders, or
+// ~/.cache/naive-wm/shaders.
+constexpr char kShaderCacheDir[] = "";
+
 ////////////////////////////////////////////////////////////////////////////////
 // Panel configurations.
 const int32_t kPanelTextSize = 16;
@@ -69,6 +80,9 @@ const int32_t kPanelTextSize = 16;
 const int32_t kPanelTimeColor = 0xFFFFFF00;
 // Workspace indicator color.
 const int32_t kPanelWorkspaceIndicatorColor = 0xFF00FF00;
+// Workspace thumbnails are this far apart, and from the panel edges and the
+// text around them.
+const int32_t kPanelThumbnailMargin = 2;
 
 // Power indicator text color.
 const int32_t kPowerIndicatorTextColor = 0xFF00FFFF;
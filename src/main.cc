@@ -9,6 +9,7 @@
 #include "backend/drm_backend/drm_backend.h"
 #include "backend/x11_backend/x11_backend.h"
 #include "compositor/compositor.h"
+#include "compositor/shell_surface.h"
 #include "wm/manage/manage_hook.h"
 #include "wm/window_manager.h"
 #include "xwayland/xwm.h"
@@ -40,6 +41,9 @@ int main(int argc, char* argv[]) {
   auto* looper = naive::MainLooper::Get();
   backend->AddHandler(looper);
   looper->AddFd(wayland_fd, [&server]() { server->DispatchEvents(); });
+  // Configures requested while handling input and client requests are sent
+  // once per loop, before the frame is drawn.
+  looper->AddHandler([]() { naive::ShellSurface::FlushConfigures(); });
   looper->AddHandler([]() { naive::compositor::Compositor::Get()->Draw(); });
   looper->Run();
 
@@ -20,16 +20,51 @@ void MainLooper::AddFd(int fd, base::HandlerFunc handler) {
 
   fds_.push_back({.fd = fd, .events = POLLIN});
   handlers_.push_back(handler);
+  handler_fds_.push_back(fd);
+}
+
+void MainLooper::RemoveFd(int fd) {
+  fds_.erase(std::remove_if(fds_.begin(), fds_.end(),
+                            [fd](pollfd& pfd) { return pfd.fd == fd; }),
+             fds_.end());
+  // The handler may be running, its slot is only cleared here.
+  for (size_t i = 0; i < handler_fds_.size(); i++) {
+    if (handler_fds_[i] != fd)
+      continue;
+    handlers_[i] = nullptr;
+    handler_fds_[i] = -1;
+    removed_ = true;
+  }
 }
 
 void MainLooper::AddHandler(base::HandlerFunc handler) {
   handlers_.push_back(handler);
+  handler_fds_.push_back(-1);
 }
 
 void MainLooper::Run() {
   for (;;) {
-    for (size_t i = 0; i < handlers_.size(); i++)
-      handlers_[i]();
+    for (size_t i = 0; i < handlers_.size(); i++) {
+      // Handlers may add others, which can move the one running.
+      auto handler = handlers_[i];
+      if (handler)
+        handler();
+    }
+    if (removed_) {
+      size_t kept = 0;
+      for (size_t i = 0; i < handlers_.size(); i++) {
+        if (!handlers_[i])
+          continue;
+        if (kept != i) {
+          handlers_[kept] = std::move(handlers_[i]);
+          handler_fds_[kept] = handler_fds_[i];
+        }
+        kept++;
+      }
+      handlers_.resize(kept);
+      handler_fds_.resize(kept);
+      removed_ = false;
+    }
     poll(fds_.data(), fds_.size(), 1);
   }
 }
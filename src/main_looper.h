@@ -16,6 +16,7 @@ class MainLooper : public base::Looper {
 
   // base::Looper overrides.
   void AddFd(int fd, base::HandlerFunc handler) override;
+  void RemoveFd(int fd) override;
   void AddHandler(base::HandlerFunc handler) override;
 
   void Run();
@@ -23,6 +24,10 @@ class MainLooper : public base::Looper {
  private:
   std::vector<pollfd> fds_;
   std::vector<base::HandlerFunc> handlers_;
+  // Fd each handler was added for, -1 for plain handlers.
+  std::vector<int> handler_fds_;
+  // Whether handlers were removed and their slots need compacting.
+  bool removed_ = false;
 };
 
 }  // namespace naive
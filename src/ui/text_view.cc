@@ -2,6 +2,7 @@
 
 #include <cairomm/context.h>
 #include <cairomm/surface.h>
+#include <cmath>
 
 #include "base/logging.h"
 
@@ -62,6 +63,17 @@ const std::string& TextView::GetText() const {
   return text_;
 }
 
+int32_t TextView::TextWidth(const std::string& text) {
+  context_->save();
+  context_->set_font_size(text_size_);
+  context_->select_font_face(font_, Cairo::FONT_SLANT_NORMAL,
+                             Cairo::FONT_WEIGHT_NORMAL);
+  Cairo::TextExtents extents;
+  context_->get_text_extents(text, extents);
+  context_->restore();
+  return static_cast<int32_t>(std::ceil(extents.x_bearing + extents.width));
+}
+
 void TextView::Draw() {
   double bgr, bgg, bgb, bga;
   ArgbToDouble(background_color_, bga, bgr, bgg, bgb);
@@ -41,6 +41,8 @@ class TextView : public Widget {
   void SetTextSize(uint32_t size);
   void SetText(const std::string& text);
   const std::string& GetText() const;
+  // Width |text| is drawn at from the left of the view, in the current font.
+  int32_t TextWidth(const std::string& text);
 
   // Widget overrides.
   void Draw() override;
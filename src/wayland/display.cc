@@ -23,6 +23,14 @@ std::unique_ptr<SubSurface> Display::CreateSubSurface(Surface* surface,
   return std::make_unique<SubSurface>(parent, surface);
 }
 
+std::unique_ptr<Viewport> Display::CreateViewport(Surface* surface) {
+  return std::make_unique<Viewport>(surface);
+}
+
+std::unique_ptr<SurfaceSync> Display::CreateSurfaceSync(Surface* surface) {
+  return std::make_unique<SurfaceSync>(surface);
+}
+
 std::unique_ptr<Surface> Display::CreateSurface() {
   return std::make_unique<Surface>();
 }
@@ -8,6 +8,8 @@
 #include "compositor/shell_surface.h"
 #include "compositor/subsurface.h"
 #include "compositor/surface.h"
+#include "compositor/surface_sync.h"
+#include "compositor/viewport.h"
 #include "wayland/shared_memory.h"
 
 namespace naive {
@@ -29,6 +31,8 @@ class Display {
                                                Surface* parent);
   std::unique_ptr<SharedMemory> CreateSharedMemory(int fd, int32_t size);
   std::unique_ptr<ShellSurface> CreateShellSurface(Surface* surface);
+  std::unique_ptr<Viewport> CreateViewport(Surface* surface);
+  std::unique_ptr<SurfaceSync> CreateSurfaceSync(Surface* surface);
 
   void AddSurfaceCreatedObserver(SurfaceCreatedObserver* observer);
   void RemoveSurfaceCreatedObserver(SurfaceCreatedObserver* observer);
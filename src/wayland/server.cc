@@ -11,7 +11,10 @@
 #include <memory>
 
 #include "input-method-unstable-v1.h"
+#include "linux-drm-syncobj-v1.h"
+#include "single-pixel-buffer-v1.h"
 #include "text-input-unstable-v1.h"
+#include "viewporter.h"
 #include "xdg-shell-unstable-v5.h"
 #include "xdg-shell-unstable-v6.h"
 #include "xwayland-keyboard-grab-unstable-v1.h"
@@ -23,8 +26,10 @@
 #include "compositor/compositor.h"
 #include "compositor/region.h"
 #include "compositor/shell_surface.h"
+#include "compositor/shm_format.h"
 #include "compositor/subsurface.h"
 #include "compositor/surface.h"
+#include "compositor/sync_timeline.h"
 #include "wayland/data_device.h"
 #include "wayland/data_offer.h"
 #include "wayland/display.h"
@@ -105,6 +110,18 @@ void surface_damage(wl_client* client,
   surface->Damage(base::geometry::Rect(x, y, width, height));
 }
 
+void surface_damage_buffer(wl_client* client,
+                           wl_resource* resource,
+                           int32_t x,
+                           int32_t y,
+                           int32_t width,
+                           int32_t height) {
+  auto* surface = GetUserDataAs<Surface>(resource);
+  TRACE("Damaging buffer of surface: %p, region: %d %d %d %d", surface, x, y,
+        width, height);
+  surface->DamageBuffer(base::geometry::Rect(x, y, width, height));
+}
+
 void HandleSurfaceFrameCallback(wl_resource* resource) {
   TRACE();
   wl_callback_send_done(resource, base::Time::CurrentTimeMilliSeconds());
@@ -144,14 +161,68 @@ void surface_set_input_region(wl_client* client,
 
 void surface_commit(wl_client* client, wl_resource* resource) {
   TRACE();
-  GetUserDataAs<Surface>(resource)->Commit();
+  auto* surface = GetUserDataAs<Surface>(resource);
+  switch (surface->CheckViewport()) {
+    case Surface::ViewportError::kNone:
+      break;
+    case Surface::ViewportError::kBadSize:
+      wl_resource_post_error(surface->viewport_resource(),
+                             WP_VIEWPORT_ERROR_BAD_SIZE,
+                             "source size is not integer");
+      return;
+    case Surface::ViewportError::kOutOfBuffer:
+      wl_resource_post_error(surface->viewport_resource(),
+                             WP_VIEWPORT_ERROR_OUT_OF_BUFFER,
+                             "source rectangle outside of the buffer");
+      return;
+  }
+  switch (surface->CheckSync()) {
+    case Surface::SyncError::kNone:
+      break;
+    case Surface::SyncError::kNoBuffer:
+      wl_resource_post_error(surface->sync_resource(),
+                             WP_LINUX_DRM_SYNCOBJ_SURFACE_V1_ERROR_NO_BUFFER,
+                             "timeline points set without a buffer");
+      return;
+    case Surface::SyncError::kUnsupportedBuffer:
+      wl_resource_post_error(
+          surface->sync_resource(),
+          WP_LINUX_DRM_SYNCOBJ_SURFACE_V1_ERROR_UNSUPPORTED_BUFFER,
+          "explicit sync needs a dmabuf buffer");
+      return;
+    case Surface::SyncError::kNoAcquirePoint:
+      wl_resource_post_error(
+          surface->sync_resource(),
+          WP_LINUX_DRM_SYNCOBJ_SURFACE_V1_ERROR_NO_ACQUIRE_POINT,
+          "buffer committed without an acquire point");
+      return;
+    case Surface::SyncError::kNoReleasePoint:
+      wl_resource_post_error(
+          surface->sync_resource(),
+          WP_LINUX_DRM_SYNCOBJ_SURFACE_V1_ERROR_NO_RELEASE_POINT,
+          "buffer committed without a release point");
+      return;
+    case Surface::SyncError::kConflictingPoints:
+      wl_resource_post_error(
+          surface->sync_resource(),
+          WP_LINUX_DRM_SYNCOBJ_SURFACE_V1_ERROR_CONFLICTING_POINTS,
+          "acquire point not before release point on the same timeline");
+      return;
+  }
+  surface->Commit();
 }
 
 void surface_set_buffer_transform(wl_client* client,
                                   wl_resource* resource,
                                   int transform) {
-  TRACE();
-  NOTIMPLEMENTED();
+  TRACE(" transform: %d", transform);
+  if (transform < WL_OUTPUT_TRANSFORM_NORMAL ||
+      transform > WL_OUTPUT_TRANSFORM_FLIPPED_270) {
+    wl_resource_post_error(resource, WL_SURFACE_ERROR_INVALID_TRANSFORM,
+                           "buffer transform %d is invalid", transform);
+    return;
+  }
+  GetUserDataAs<Surface>(resource)->SetBufferTransform(transform);
 }
 
 void surface_set_buffer_scale(wl_client* client,
@@ -175,7 +246,8 @@ const struct wl_surface_interface surface_implementation = {
     surface_set_input_region,
     surface_commit,
     surface_set_buffer_transform,
-    surface_set_buffer_scale};
+    surface_set_buffer_scale,
+    surface_damage_buffer};
 
 ///////////////////////////////////////////////////////////////////////////////
 // wl_region_interface
@@ -266,13 +338,33 @@ void shm_pool_create_buffer(wl_client* client,
                             uint32_t format) {
   TRACE("create buffer: %d %d %d %d format: %d", offset, width, height, stride,
         format);
-  if (format != WL_SHM_FORMAT_XRGB8888 && format != WL_SHM_FORMAT_ARGB8888) {
+  auto* shm_format = compositor::FindShmFormat(format, false);
+  if (!shm_format) {
     std::cerr << "unsupported format " << format;
     return;
   }
+  auto* shared_memory = GetUserDataAs<SharedMemory>(resource);
+  // Planar formats keep their chroma planes after the luma plane, all of
+  // which has to fit into the pool.
+  if (offset < 0 || width <= 0 || height <= 0 || stride <= 0 ||
+      offset + compositor::ShmBufferSize(*shm_format, stride, height) >
+          shared_memory->size()) {
+    wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_STRIDE,
+                           "buffer does not fit into the pool");
+    return;
+  }
+  // A row of the first plane has to fit into the stride.
+  const compositor::ShmPlane& plane = shm_format->planes[0];
+  int64_t row_texels = (static_cast<int64_t>(width) +
+                        plane.horizontal_subsampling - 1) /
+                       plane.horizontal_subsampling;
+  if (row_texels * plane.bytes_per_texel > stride) {
+    wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_STRIDE,
+                           "stride is shorter than a row");
+    return;
+  }
   std::unique_ptr<Buffer> buffer =
-      GetUserDataAs<SharedMemory>(resource)->CreateBuffer(width, height, format,
-                                                          offset, stride);
+      shared_memory->CreateBuffer(width, height, format, offset, stride);
   if (!buffer) {
     std::cerr << "unable to map buffer";
     return;
@@ -329,8 +421,8 @@ void bind_shm(wl_client* client, void* data, uint32_t version, uint32_t id) {
 
   wl_resource_set_implementation(resource, &shm_implementation, data, nullptr);
 
-  wl_shm_send_format(resource, WL_SHM_FORMAT_XRGB8888);
-  wl_shm_send_format(resource, WL_SHM_FORMAT_ARGB8888);
+  for (uint32_t format : compositor::SupportedShmFormats())
+    wl_shm_send_format(resource, format);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -810,7 +902,7 @@ void xdg_surface_v5_ack_configure(wl_client* client,
                                   wl_resource* resource,
                                   uint32_t serial) {
   TRACE();
-  NOTIMPLEMENTED();
+  GetUserDataAs<ShellSurface>(resource)->AcknowledgeConfigure(serial);
 }
 
 void xdg_surface_v5_set_window_geometry(wl_client* client,
@@ -1339,6 +1431,7 @@ if (shell_surface->window()->IsManaged()) {
   shell_surface->set_configure_callback(
       std::bind(&HandleXdgToplevelV6ConfigureCallback, xdg_toplevel_resource,
                 resource, std::placeholders::_1, std::placeholders::_2));
+  shell_surface->set_sends_activated(true);
   wl_resource_set_implementation(xdg_toplevel_resource,
                                  &xdg_toplevel_v6_implementation, shell_surface,
                                  nullptr);
@@ -2169,6 +2262,280 @@ void bind_zwp_xwayland_keyboard_grab_manager_v1(wl_client* client,
       nullptr);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// wp_single_pixel_buffer_manager_v1 interfaces:
+
+void wp_single_pixel_buffer_manager_v1_destroy(wl_client* client,
+                                               wl_resource* resource) {
+  wl_resource_destroy(resource);
+}
+
+void wp_single_pixel_buffer_manager_v1_create_u32_rgba_buffer(
+    wl_client* client,
+    wl_resource* resource,
+    uint32_t id,
+    uint32_t r,
+    uint32_t g,
+    uint32_t b,
+    uint32_t a) {
+  TRACE("create single pixel buffer: %u %u %u %u", r, g, b, a);
+  // Channels span the full uint32_t range; keep the top 8 bits of each.
+  uint32_t pixel = (a >> 24) << 24 | (r >> 24) << 16 | (g >> 24) << 8 | b >> 24;
+  auto buffer = std::make_unique<Buffer>(pixel);
+
+  wl_resource* buffer_resource =
+      wl_resource_create(client, &wl_buffer_interface, 1, id);
+  buffer->set_release_callback(
+      std::bind(&HandleBufferReleaseCallback, buffer_resource));
+  SetImplementation(buffer_resource, &buffer_implementation, std::move(buffer));
+}
+
+const struct wp_single_pixel_buffer_manager_v1_interface
+    wp_single_pixel_buffer_manager_v1_implementation = {
+        wp_single_pixel_buffer_manager_v1_destroy,
+        wp_single_pixel_buffer_manager_v1_create_u32_rgba_buffer};
+
+void bind_wp_single_pixel_buffer_manager_v1(wl_client* client,
+                                            void* data,
+                                            uint32_t version,
+                                            uint32_t id) {
+  TRACE();
+  wl_resource* resource = wl_resource_create(
+      client, &wp_single_pixel_buffer_manager_v1_interface, version, id);
+  wl_resource_set_implementation(
+      resource, &wp_single_pixel_buffer_manager_v1_implementation, data,
+      nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// wp_viewporter interfaces:
+
+Viewport* GetViewportWithSurface(wl_resource* resource) {
+  auto* viewport = GetUserDataAs<Viewport>(resource);
+  if (!viewport->surface()) {
+    wl_resource_post_error(resource, WP_VIEWPORT_ERROR_NO_SURFACE,
+                           "the surface was destroyed");
+    return nullptr;
+  }
+  return viewport;
+}
+
+void wp_viewport_destroy(wl_client* client, wl_resource* resource) {
+  TRACE();
+  wl_resource_destroy(resource);
+}
+
+void wp_viewport_set_source(wl_client* client,
+                            wl_resource* resource,
+                            wl_fixed_t x,
+                            wl_fixed_t y,
+                            wl_fixed_t width,
+                            wl_fixed_t height) {
+  auto* viewport = GetViewportWithSurface(resource);
+  if (!viewport)
+    return;
+  float source_x = wl_fixed_to_double(x);
+  float source_y = wl_fixed_to_double(y);
+  float source_width = wl_fixed_to_double(width);
+  float source_height = wl_fixed_to_double(height);
+  TRACE("source: %f %f %f %f", source_x, source_y, source_width,
+        source_height);
+  bool unset = source_x == -1 && source_y == -1 && source_width == -1 &&
+               source_height == -1;
+  if (!unset && (source_x < 0 || source_y < 0 || source_width <= 0 ||
+                 source_height <= 0)) {
+    wl_resource_post_error(resource, WP_VIEWPORT_ERROR_BAD_VALUE,
+                           "invalid source rectangle");
+    return;
+  }
+  viewport->SetSource(source_x, source_y, source_width, source_height);
+}
+
+void wp_viewport_set_destination(wl_client* client,
+                                 wl_resource* resource,
+                                 int32_t width,
+                                 int32_t height) {
+  TRACE("destination: %d %d", width, height);
+  auto* viewport = GetViewportWithSurface(resource);
+  if (!viewport)
+    return;
+  bool unset = width == -1 && height == -1;
+  if (!unset && (width <= 0 || height <= 0)) {
+    wl_resource_post_error(resource, WP_VIEWPORT_ERROR_BAD_VALUE,
+                           "invalid destination size");
+    return;
+  }
+  viewport->SetDestination(width, height);
+}
+
+const struct wp_viewport_interface wp_viewport_implementation = {
+    wp_viewport_destroy, wp_viewport_set_source, wp_viewport_set_destination};
+
+void wp_viewporter_destroy(wl_client* client, wl_resource* resource) {
+  wl_resource_destroy(resource);
+}
+
+void wp_viewporter_get_viewport(wl_client* client,
+                                wl_resource* resource,
+                                uint32_t id,
+                                wl_resource* surface_resource) {
+  TRACE();
+  auto* surface = GetUserDataAs<Surface>(surface_resource);
+  if (surface->viewport_resource()) {
+    wl_resource_post_error(resource, WP_VIEWPORTER_ERROR_VIEWPORT_EXISTS,
+                           "the surface already has a viewport");
+    return;
+  }
+  wl_resource* viewport_resource =
+      wl_resource_create(client, &wp_viewport_interface, 1, id);
+  surface->set_viewport_resource(viewport_resource);
+  SetImplementation(viewport_resource, &wp_viewport_implementation,
+                    GetUserDataAs<Display>(resource)->CreateViewport(surface));
+}
+
+const struct wp_viewporter_interface wp_viewporter_implementation = {
+    wp_viewporter_destroy, wp_viewporter_get_viewport};
+
+void bind_wp_viewporter(wl_client* client,
+                        void* data,
+                        uint32_t version,
+                        uint32_t id) {
+  TRACE();
+  wl_resource* resource =
+      wl_resource_create(client, &wp_viewporter_interface, version, id);
+  wl_resource_set_implementation(resource, &wp_viewporter_implementation, data,
+                                 nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// wp_linux_drm_syncobj interfaces:
+
+using SyncTimelineRef = std::shared_ptr<compositor::SyncTimeline>;
+
+void wp_linux_drm_syncobj_timeline_destroy(wl_client* client,
+                                           wl_resource* resource) {
+  wl_resource_destroy(resource);
+}
+
+const struct wp_linux_drm_syncobj_timeline_v1_interface
+    wp_linux_drm_syncobj_timeline_implementation = {
+        wp_linux_drm_syncobj_timeline_destroy};
+
+// Fills |point| from |timeline| and the two halves of its value. Returns the
+// synchronization object, or null after posting an error if the surface is
+// gone.
+SurfaceSync* GetSyncPoint(wl_resource* resource,
+                          wl_resource* timeline,
+                          uint32_t point_hi,
+                          uint32_t point_lo,
+                          compositor::SyncPoint* point) {
+  auto* sync = GetUserDataAs<SurfaceSync>(resource);
+  if (!sync->surface()) {
+    wl_resource_post_error(resource,
+                           WP_LINUX_DRM_SYNCOBJ_SURFACE_V1_ERROR_NO_SURFACE,
+                           "the surface was destroyed");
+    return nullptr;
+  }
+  point->timeline = *GetUserDataAs<SyncTimelineRef>(timeline);
+  point->point = static_cast<uint64_t>(point_hi) << 32 | point_lo;
+  return sync;
+}
+
+void wp_linux_drm_syncobj_surface_destroy(wl_client* client,
+                                          wl_resource* resource) {
+  TRACE();
+  wl_resource_destroy(resource);
+}
+
+void wp_linux_drm_syncobj_surface_set_acquire_point(wl_client* client,
+                                                    wl_resource* resource,
+                                                    wl_resource* timeline,
+                                                    uint32_t point_hi,
+                                                    uint32_t point_lo) {
+  compositor::SyncPoint point;
+  auto* sync = GetSyncPoint(resource, timeline, point_hi, point_lo, &point);
+  if (sync)
+    sync->SetAcquirePoint(point);
+}
+
+void wp_linux_drm_syncobj_surface_set_release_point(wl_client* client,
+                                                    wl_resource* resource,
+                                                    wl_resource* timeline,
+                                                    uint32_t point_hi,
+                                                    uint32_t point_lo) {
+  compositor::SyncPoint point;
+  auto* sync = GetSyncPoint(resource, timeline, point_hi, point_lo, &point);
+  if (sync)
+    sync->SetReleasePoint(point);
+}
+
+const struct wp_linux_drm_syncobj_surface_v1_interface
+    wp_linux_drm_syncobj_surface_implementation = {
+        wp_linux_drm_syncobj_surface_destroy,
+        wp_linux_drm_syncobj_surface_set_acquire_point,
+        wp_linux_drm_syncobj_surface_set_release_point};
+
+void wp_linux_drm_syncobj_manager_destroy(wl_client* client,
+                                          wl_resource* resource) {
+  wl_resource_destroy(resource);
+}
+
+void wp_linux_drm_syncobj_manager_get_surface(wl_client* client,
+                                              wl_resource* resource,
+                                              uint32_t id,
+                                              wl_resource* surface_resource) {
+  TRACE();
+  auto* surface = GetUserDataAs<Surface>(surface_resource);
+  if (surface->sync_resource()) {
+    wl_resource_post_error(
+        resource, WP_LINUX_DRM_SYNCOBJ_MANAGER_V1_ERROR_SURFACE_EXISTS,
+        "the surface already has a synchronization object");
+    return;
+  }
+  wl_resource* sync_resource = wl_resource_create(
+      client, &wp_linux_drm_syncobj_surface_v1_interface, 1, id);
+  surface->set_sync_resource(sync_resource);
+  SetImplementation(
+      sync_resource, &wp_linux_drm_syncobj_surface_implementation,
+      GetUserDataAs<Display>(resource)->CreateSurfaceSync(surface));
+}
+
+void wp_linux_drm_syncobj_manager_import_timeline(wl_client* client,
+                                                  wl_resource* resource,
+                                                  uint32_t id,
+                                                  int32_t fd) {
+  TRACE("fd: %d", fd);
+  auto timeline = compositor::SyncTimeline::Import(fd);
+  if (!timeline) {
+    wl_resource_post_error(
+        resource, WP_LINUX_DRM_SYNCOBJ_MANAGER_V1_ERROR_INVALID_TIMELINE,
+        "the fd is not a DRM syncobj");
+    return;
+  }
+  wl_resource* timeline_resource = wl_resource_create(
+      client, &wp_linux_drm_syncobj_timeline_v1_interface, 1, id);
+  SetImplementation(timeline_resource,
+                    &wp_linux_drm_syncobj_timeline_implementation,
+                    std::make_unique<SyncTimelineRef>(timeline));
+}
+
+const struct wp_linux_drm_syncobj_manager_v1_interface
+    wp_linux_drm_syncobj_manager_implementation = {
+        wp_linux_drm_syncobj_manager_destroy,
+        wp_linux_drm_syncobj_manager_get_surface,
+        wp_linux_drm_syncobj_manager_import_timeline};
+
+void bind_wp_linux_drm_syncobj_manager(wl_client* client,
+                                       void* data,
+                                       uint32_t version,
+                                       uint32_t id) {
+  TRACE();
+  wl_resource* resource = wl_resource_create(
+      client, &wp_linux_drm_syncobj_manager_v1_interface, version, id);
+  wl_resource_set_implementation(
+      resource, &wp_linux_drm_syncobj_manager_implementation, data, nullptr);
+}
+
 }  // namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2180,7 +2547,7 @@ Server::Server(Display* display)
                                              std::placeholders::_2))) {
   wl_display_ = wl_display_create();
   AddSocket();
-  wl_global_create(wl_display_, &wl_compositor_interface, 3, display_,
+  wl_global_create(wl_display_, &wl_compositor_interface, 4, display_,
                    &bind_compositor);
   wl_global_create(wl_display_, &wl_shm_interface, 1, display_, &bind_shm);
   wl_global_create(wl_display_, &wl_subcompositor_interface, 1, display_,
@@ -2205,6 +2572,17 @@ Server::Server(Display* display)
                    display_, &bind_zwp_xwayland_keyboard_grab_manager_v1);
   wl_global_create(wl_display_, &wl_data_device_manager_interface, 1, display_,
                    bind_data_device_manager);
+  wl_global_create(wl_display_, &wp_single_pixel_buffer_manager_v1_interface,
+                   1, display_, &bind_wp_single_pixel_buffer_manager_v1);
+  wl_global_create(wl_display_, &wp_viewporter_interface, 1, display_,
+                   &bind_wp_viewporter);
+  // Explicit sync needs a DRM device to import client timelines into, and
+  // is only allowed on dmabuf buffers, so it is not advertised to clients
+  // that could not use it on any buffer.
+  if (Buffer::DmaBufSupported() && compositor::SyncTimeline::Supported()) {
+    wl_global_create(wl_display_, &wp_linux_drm_syncobj_manager_v1_interface,
+                     1, display_, &bind_wp_linux_drm_syncobj_manager);
+  }
 }
 
 void Server::AddSocket() {
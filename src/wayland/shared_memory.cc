@@ -1,5 +1,8 @@
 #include "wayland/shared_memory.h"
 
+#include <fcntl.h>
+#include <linux/udmabuf.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <wayland-server.h>
@@ -7,12 +10,84 @@
 namespace naive {
 namespace wayland {
 
+namespace {
+
+// Whether the udmabuf device was found missing, so no pool tries it again.
+bool udmabuf_missing = false;
+uint32_t next_dmabuf_id = 1;
+
+}  // namespace
+
+ShmPool::~ShmPool() {
+  TRACE("%p", this);
+  CloseDmaBuf();
+  if (memfd_ >= 0)
+    close(memfd_);
+  munmap(data_, size_);
+}
+
+void ShmPool::set_data(void* data, uint32_t size) {
+  data_ = data;
+  size_ = size;
+  // Buffers past the old end are not covered, wrap the pool again.
+  CloseDmaBuf();
+  dmabuf_failed_ = false;
+}
+
+int ShmPool::dmabuf_fd() {
+  if (dmabuf_fd_ >= 0 || memfd_ < 0 || dmabuf_failed_ || udmabuf_missing)
+    return dmabuf_fd_;
+  // udmabuf only takes whole pages.
+  uint32_t page_size = sysconf(_SC_PAGESIZE);
+  uint32_t size = size_ / page_size * page_size;
+  dmabuf_failed_ = true;
+  if (!size)
+    return -1;
+
+  int device = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+  if (device < 0) {
+    LOG_INFO << "no /dev/udmabuf, shm pools are copied" << std::endl;
+    udmabuf_missing = true;
+    return -1;
+  }
+  struct udmabuf_create create = {};
+  create.memfd = memfd_;
+  create.flags = UDMABUF_FLAGS_CLOEXEC;
+  create.offset = 0;
+  create.size = size;
+  int fd = ioctl(device, UDMABUF_CREATE, &create);
+  close(device);
+  if (fd < 0) {
+    TRACE("udmabuf creation failed for pool %p", this);
+    return -1;
+  }
+  dmabuf_failed_ = false;
+  dmabuf_fd_ = fd;
+  dmabuf_size_ = size;
+  dmabuf_id_ = next_dmabuf_id++;
+  return dmabuf_fd_;
+}
+
+void ShmPool::CloseDmaBuf() {
+  if (dmabuf_fd_ >= 0)
+    close(dmabuf_fd_);
+  dmabuf_fd_ = -1;
+  dmabuf_size_ = 0;
+}
+
 SharedMemory::SharedMemory(int fd, uint32_t size) {
   void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
   if (data == MAP_FAILED)
     TRACE("mmap failed");
-  shm_data_ = std::make_shared<ShmPool>(size, data);
-  close(fd);
+  // udmabuf takes memfds that cannot shrink, anything else is only copied
+  // from and needs no fd.
+  int seals = fcntl(fd, F_GET_SEALS);
+  if (seals >= 0 && (seals & F_SEAL_SHRINK)) {
+    shm_data_ = std::make_shared<ShmPool>(size, data, fd);
+  } else {
+    shm_data_ = std::make_shared<ShmPool>(size, data);
+    close(fd);
+  }
 }
 
 SharedMemory::~SharedMemory() {
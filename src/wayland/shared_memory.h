@@ -16,23 +16,34 @@ namespace wayland {
 
 class ShmPool {
  public:
-  ShmPool(uint32_t size, void* data) : size_(size), data_(data) {
+  // |memfd| is kept if the pool can be wrapped as a dmabuf, -1 otherwise.
+  ShmPool(uint32_t size, void* data, int memfd = -1)
+      : size_(size), data_(data), memfd_(memfd) {
     TRACE("%p", this);
   }
-  ~ShmPool() {
-    TRACE("%p", this);
-    munmap(data_, size_);
-  }
+  ~ShmPool();
   uint32_t size() { return size_; }
   void* data() { return data_; }
-  void set_data(void* data, uint32_t size) {
-    data_ = data;
-    size_ = size;
-  }
+  void set_data(void* data, uint32_t size);
+
+  // Returns a dmabuf of the pool through udmabuf, created on first use, or -1
+  // if the pool cannot be wrapped. It covers |dmabuf_size()| bytes from the
+  // start of the pool, and |dmabuf_id()| changes whenever it is recreated.
+  int dmabuf_fd();
+  uint32_t dmabuf_size() { return dmabuf_size_; }
+  uint32_t dmabuf_id() { return dmabuf_id_; }
 
  private:
+  void CloseDmaBuf();
+
   uint32_t size_;
   void* data_;
+  int memfd_;
+  int dmabuf_fd_ = -1;
+  uint32_t dmabuf_size_ = 0;
+  uint32_t dmabuf_id_ = 0;
+  // Whether creating the dmabuf failed, so it is not tried again.
+  bool dmabuf_failed_ = false;
 };
 
 class SharedMemory {
@@ -41,6 +52,7 @@ class SharedMemory {
   ~SharedMemory();
 
   void Resize(uint32_t size);
+  uint32_t size() { return shm_data_->size(); }
   std::unique_ptr<Buffer> CreateBuffer(int32_t width,
                                        int32_t height,
                                        int32_t format,
@@ -0,0 +1,63 @@
+#include "wm/layout_transaction.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/time.h"
+
+namespace naive {
+namespace wm {
+
+namespace {
+
+// Longest a layout change holds presentation for clients slow to redraw.
+constexpr uint32_t kTimeoutMs = 150;
+
+}  // namespace
+
+void LayoutTransaction::Begin() {
+  depth_++;
+}
+
+void LayoutTransaction::End() {
+  if (--depth_ > 0)
+    return;
+  // A transaction finishing while an earlier one is still waited on joins
+  // its wait rather than extending it.
+  if (!pending_.empty() && !deadline_ms_)
+    deadline_ms_ = base::Time::CurrentTimeMilliSeconds() + kTimeoutMs;
+}
+
+void LayoutTransaction::AddWindow(Window* window) {
+  if (!depth_)
+    return;
+  if (std::find(pending_.begin(), pending_.end(), window) == pending_.end())
+    pending_.push_back(window);
+}
+
+void LayoutTransaction::OnWindowReady(Window* window) {
+  RemoveWindow(window);
+}
+
+void LayoutTransaction::RemoveWindow(Window* window) {
+  pending_.erase(std::remove(pending_.begin(), pending_.end(), window),
+                 pending_.end());
+}
+
+bool LayoutTransaction::Holding() {
+  if (depth_ || !deadline_ms_)
+    return false;
+  if (!pending_.empty() &&
+      static_cast<int32_t>(base::Time::CurrentTimeMilliSeconds() -
+                           deadline_ms_) < 0)
+    return true;
+  if (!pending_.empty())
+    TRACE("layout transaction timed out, %zu windows pending",
+          pending_.size());
+  pending_.clear();
+  deadline_ms_ = 0;
+  return false;
+}
+
+}  // namespace wm
+}  // namespace naive
@@ -0,0 +1,62 @@
+#ifndef WM_LAYOUT_TRANSACTION_H_
+#define WM_LAYOUT_TRANSACTION_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "base/macros.h"
+
+namespace naive {
+namespace wm {
+
+class Window;
+
+// Groups the configures sent by one layout change. Once the change is laid
+// out, presentation is held until every window it resized has committed a
+// buffer acknowledging its last configure, or until a timeout, so the new
+// layout shows up in one frame instead of window by window.
+class LayoutTransaction {
+ public:
+  LayoutTransaction() = default;
+
+  // Transactions nest, the outermost End() starts the wait.
+  void Begin();
+  void End();
+
+  // Called when |window| was sent a configure it has to acknowledge. Ignored
+  // unless a transaction is open.
+  void AddWindow(Window* window);
+  // Called when |window| committed a buffer for its last configure.
+  void OnWindowReady(Window* window);
+  void RemoveWindow(Window* window);
+
+  // Whether presentation waits on windows of a finished transaction.
+  bool Holding();
+
+ private:
+  int32_t depth_ = 0;
+  std::vector<Window*> pending_;
+  // When the wait gives up, 0 while no finished transaction is waited on.
+  uint32_t deadline_ms_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(LayoutTransaction);
+};
+
+class ScopedLayoutTransaction {
+ public:
+  explicit ScopedLayoutTransaction(LayoutTransaction* transaction)
+      : transaction_(transaction) {
+    transaction_->Begin();
+  }
+  ~ScopedLayoutTransaction() { transaction_->End(); }
+
+ private:
+  LayoutTransaction* transaction_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLayoutTransaction);
+};
+
+}  // namespace wm
+}  // namespace naive
+
+#endif  // WM_LAYOUT_TRANSACTION_H_
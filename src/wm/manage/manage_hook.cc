@@ -54,6 +54,17 @@ void ManageHook::PostWmInitialize() {
 
   panel_ = std::make_unique<Panel>(0, 0, display_metrics_->width_pixels, 20);
   wm::WindowManager::Get()->set_panel_window(panel_->window());
+  compositor::Compositor::Get()->SetWorkspaceThumbnailSlots(
+      panel_->ThumbnailSlots(display_metrics_->width_pixels,
+                             display_metrics_->height_pixels,
+                             workspaces_.size()));
+}
+
+void ManageHook::UpdateWorkspaceThumbnails() {
+  for (size_t i = 0; i < workspaces_.size(); i++) {
+    compositor::Compositor::Get()->SetWorkspaceWindows(
+        i, workspaces_[i].windows());
+  }
 }
 
 void ManageHook::WindowCreated(Window* window) {
@@ -76,6 +87,7 @@ void ManageHook::WindowCreated(Window* window) {
   workspace->ArrangeWindows(config::kWorkspaceInsetX, config::kWorkspaceInsetY,
                             width_ - config::kWorkspaceInsetX,
                             height_ - config::kWorkspaceInsetY);
+  UpdateWorkspaceThumbnails();
 }
 
 void ManageHook::WindowDestroying(Window* window) {
@@ -106,6 +118,7 @@ void ManageHook::WindowDestroyed(Window* window) {
       break;
     }
   }
+  UpdateWorkspaceThumbnails();
 }
 
 bool ManageHook::OnKey(KeyboardEvent* event) {
@@ -260,6 +273,7 @@ void ManageHook::SelectTag(size_t tag) {
   if (current_workspace_ == tag)
     return;
   previous_tag_ = current_workspace_;
+  compositor::Compositor::Get()->MarkWorkspaceSwitch();
   if (popup_terminal_pid_) {
     ManageWindow* window =
         current_workspace()->FindWindowByPid(popup_terminal_pid_);
@@ -286,6 +300,7 @@ void ManageHook::SelectTag(size_t tag) {
   for (auto& workspace : workspaces_)
     window_count.push_back(workspace.window_count());
   panel_->OnWorkspaceChanged(tag, window_count);
+  UpdateWorkspaceThumbnails();
 }
 
 void ManageHook::MoveWindowToTag(Window* window, size_t tag) {
@@ -306,6 +321,7 @@ void ManageHook::MoveWindowToTag(Window* window, size_t tag) {
   for (auto& workspace : workspaces_)
     window_count.push_back(workspace.window_count());
   panel_->OnWorkspaceChanged(current_workspace_, window_count);
+  UpdateWorkspaceThumbnails();
 }
 
 void ManageHook::RegisterKeys() {
@@ -369,6 +385,8 @@ void ManageHook::RegisterKeys() {
     wm::WindowManager::Get()->DumpWindowHierarchy();
     TRACE("============== END WINDOW HIERARCHY ========================");
   });
+  (super_ + shift_ + KEY_S).Action(
+      []() { compositor::Compositor::Get()->DumpStats(); });
 }
 
 void ManageHook::AddWindowCallbacks() {
@@ -105,6 +105,8 @@ class ManageHook : public WmEventObserver {
 
  private:
   uint64_t GetKey(KeyboardEvent* event);
+  // Tells the compositor which windows each workspace thumbnail shows.
+  void UpdateWorkspaceThumbnails();
 
   std::vector<Workspace> workspaces_;
   size_t current_workspace_;
@@ -1,5 +1,6 @@
 #include "wm/manage/panel.h"
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 
@@ -42,19 +43,55 @@ Panel::Panel(int32_t x, int32_t y, int32_t width, int32_t height)
   SetText("<1>");
 }
 
+std::vector<base::geometry::Rect> Panel::ThumbnailSlots(
+    int32_t screen_width,
+    int32_t screen_height,
+    size_t count) {
+  std::vector<base::geometry::Rect> slots;
+  if (!count)
+    return slots;
+  auto& bounds = GetBounds();
+  // The indicator is widest with every workspace holding windows.
+  std::string widest = WorkspaceText(0, std::vector<int32_t>(count, 1));
+  int32_t left = TextWidth(widest) + config::kPanelThumbnailMargin;
+  int32_t right = std::min(time_view_.GetBounds().x(),
+                           power_indicator_.GetBounds().x()) -
+                  config::kPanelThumbnailMargin;
+  int32_t slot_count = static_cast<int32_t>(count);
+  int32_t margins = (slot_count - 1) * config::kPanelThumbnailMargin;
+  int32_t height = bounds.height() - 2 * config::kPanelThumbnailMargin;
+  int32_t width = std::min(height * screen_width / screen_height,
+                           (right - left - margins) / slot_count);
+  height = width * screen_height / screen_width;
+  if (height <= 0 || width <= 0)
+    return slots;
+  int32_t x = bounds.x() + left;
+  int32_t y = bounds.y() + (bounds.height() - height) / 2;
+  for (size_t i = 0; i < count; i++) {
+    slots.push_back(base::geometry::Rect(x, y, width, height));
+    x += width + config::kPanelThumbnailMargin;
+  }
+  return slots;
+}
+
 void Panel::OnWorkspaceChanged(int32_t workspace,
                                const std::vector<int32_t>& window_count) {
+  SetText(WorkspaceText(workspace, window_count));
+}
+
+std::string Panel::WorkspaceText(int32_t workspace,
+                                 const std::vector<int32_t>& window_count) {
   std::stringstream ss;
 
-  for (int i = 0; i < 9; i++) {
-    if (workspace == i) {
+  for (size_t i = 0; i < window_count.size(); i++) {
+    if (workspace == static_cast<int32_t>(i)) {
       ss << "<" << i + 1 << "> ";
       continue;
     }
     if (window_count[i] != 0)
       ss << " " << i + 1 << "  ";
   }
-  SetText(ss.str());
+  return ss.str();
 }
 
 }  // namespace wm
@@ -25,8 +25,18 @@ class Panel : public ui::TextView {
   explicit Panel(int32_t x, int32_t y, int32_t width, int32_t height);
   void OnWorkspaceChanged(int32_t workspace,
                           const std::vector<int32_t>& window_count);
+  // Slots for the thumbnails of |count| workspaces, which keep the aspect
+  // ratio of the screen. They go between the workspace indicator and the
+  // indicators on the right, shrunk to fit there.
+  std::vector<base::geometry::Rect> ThumbnailSlots(int32_t screen_width,
+                                                   int32_t screen_height,
+                                                   size_t count);
   TimeView time_view_;
   extra::PowerIndicator power_indicator_;
+
+ private:
+  std::string WorkspaceText(int32_t workspace,
+                            const std::vector<int32_t>& window_count);
 };
 
 }  // namespace wm
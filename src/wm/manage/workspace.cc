@@ -23,14 +23,21 @@ void ArrangeNonFloatingWindows(std::deque<ManageWindow*>& candidates,
                                int32_t inset_y) {
   SplitExec exec(config::kLayouts[tag],
                  base::geometry::Rect(x, y, width, height), candidates.size());
+  // Only windows whose rectangle changed are moved and reconfigured.
+  int32_t changed = 0;
   for (int32_t i = 0; i < candidates.size(); i++) {
     auto* front = candidates[i];
     auto rect = exec.NextRect(i);
+    bool moved;
     if (front->is_maximized())
-      front->MoveResize(0, inset_y, screen_width_, screen_height_);
+      moved = front->MoveResize(0, inset_y, screen_width_, screen_height_);
     else
-      front->MoveResize(rect.x(), rect.y(), rect.width(), rect.height());
+      moved =
+          front->MoveResize(rect.x(), rect.y(), rect.width(), rect.height());
+    if (moved)
+      changed++;
   }
+  TRACE("re-layout changed %d of %zu windows", changed, candidates.size());
 }
 
 }  // namespace
@@ -126,6 +133,13 @@ void Workspace::Show(bool show) {
     window->Show(show, ManageWindowShowReason::SHOW_WORKSPACE_CHANGE);
 }
 
+std::vector<Window*> Workspace::windows() {
+  std::vector<Window*> result;
+  for (auto& mw : windows_)
+    result.push_back(mw->window());
+  return result;
+}
+
 void Workspace::SetCurrentWindow(Window* window) {
   for (size_t i = 0; i < windows_.size(); i++) {
     if (windows_[i]->window() == window)
@@ -137,6 +151,10 @@ void Workspace::ArrangeWindows(int32_t x,
                                int32_t y,
                                int32_t width,
                                int32_t height) {
+  // The windows resized here are presented together, once all of them drew
+  // at their new size.
+  ScopedLayoutTransaction transaction(
+      WindowManager::Get()->layout_transaction());
   std::vector<ManageWindow*> floating_windows;
   std::deque<ManageWindow*> normal_windows;
 
@@ -27,9 +27,17 @@ class ManageWindow {
     if (show_predicate_(show, reason))
       window_->set_visible(show);
   }
-  void MoveResize(int32_t x, int32_t y, int32_t width, int32_t height) {
+  // Returns false if the window already has these bounds and was left
+  // alone. The size is the one the client committed, so a client that did
+  // not take the size it was configured with is configured again.
+  bool MoveResize(int32_t x, int32_t y, int32_t width, int32_t height) {
+    auto geometry = window_->geometry();
+    if (window_->wm_x() == x && window_->wm_y() == y &&
+        geometry.width() == width && geometry.height() == height)
+      return false;
     primitives_->MoveResizeWindow(window_,
                                   base::geometry::Rect(x, y, width, height));
+    return true;
   }
 
   void set_maximized(bool maximized) { maximized_ = maximized; }
@@ -71,6 +79,7 @@ class Workspace {
   bool HasWindow(Window* window);
   ManageWindow* FindWindowByPid(pid_t pid);
   int32_t window_count() { return windows_.size(); }
+  std::vector<Window*> windows();
   uint32_t tag() { return tag_; }
 
  private:
@@ -34,6 +34,7 @@ Window::~Window() {
   for (auto* observer : window_observers_)
     observer->OnWindowDestroyed(this);
   compositor::Compositor::Get()->AddGlobalDamage(global_bound(), this);
+  compositor::Compositor::Get()->OnWindowDestroyed(this);
   wm::WindowManager::Get()->RemoveWindow(this);
   if (parent_) {
     TRACE("removing window %p from parent: %p", this, parent_);
@@ -212,7 +213,7 @@ void Window::LoseFocus() {
   }
   if (focused_) {
     focused_ = false;
-    // TODO: Not seem to need to configure?
+    window_impl_->LoseFocus();
   }
 }
 
@@ -256,10 +257,10 @@ void Window::set_visible(bool visible) {
 
   window_impl_->OnVisibilityChanged(visible);
   TRACE("%p -> visible: %d", this, visible);
-  if (visible)
-    surface()->ForceDamage(geometry());
+  // The texture is kept while hidden, so showing needs no re-upload.
   compositor::Compositor::Get()->AddGlobalDamage(global_bound(), this);
   visible_ = visible;
+  compositor::Compositor::Get()->OnWindowVisibilityChanged(this, visible);
 }
 
 void Window::NotifyFrameCallback() {
@@ -90,6 +90,10 @@ class Window {
   // TODO: This needs to commit as well.
   void WmSetSize(int32_t width, int32_t height);
   void WmSetPosition(int32_t x, int32_t y) {
+    if (x == wm_x_ && y == wm_y_)
+      return;
+    // Damaging the old and new bounds is enough to redraw the window, its
+    // content did not change.
     auto bounds = geometry();
     compositor::Compositor::Get()->AddGlobalDamage(
         base::geometry::Rect(bounds.x() + wm_x_, bounds.y() + wm_y_,
@@ -101,7 +105,6 @@ class Window {
         base::geometry::Rect(bounds.x() + wm_x_, bounds.y() + wm_y_,
                              bounds.width(), bounds.height()),
         this);
-    surface_->force_commit();
   }
   base::geometry::Rect GetToDrawRegion() {
     if (visible_region_.Empty())
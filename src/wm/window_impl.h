@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "base/geometry.h"
+#include "compositor/buffer_viewport.h"
 #include "compositor/draw_quad.h"
 #include "compositor/region.h"
 #include "compositor/texture_delegate.h"
@@ -45,18 +46,31 @@ class WindowImpl {
   // Window receives focus.
   virtual void TakeFocus() = 0;
 
+  // Window loses focus.
+  virtual void LoseFocus() = 0;
+
   // Forces the surface to be fully redrawn.
   virtual void ForceCommit() = 0;
 
   // Whether the surface has newly committed content.
   virtual bool HasCommit() = 0;
 
-  // Retrieves the damaged region of the underline surface.
+  // Retrieves the damaged region of the underline surface, in buffer
+  // coordinates.
   virtual Region DamagedRegion() = 0;
 
+  // Retrieves the region the underline surface declares to be opaque, in
+  // view coordinates.
+  virtual Region OpaqueRegion() { return Region::Empty(); }
+
   // Gets the underline quad of the surface.
   virtual compositor::DrawQuad GetQuad() = 0;
 
+  // Gets how the quad is cropped and scaled onto the surface.
+  virtual compositor::BufferViewport GetViewport() {
+    return compositor::BufferViewport();
+  }
+
   // Called by compositor that the commit is picked up.
   virtual void ClearCommit() = 0;
 
@@ -23,6 +23,7 @@ class WindowImplCairo : public WindowImpl {
   void AddDamage(const base::geometry::Rect& rect) override;
   void Configure(int32_t width, int32_t height) override {}
   void TakeFocus() override {}
+  void LoseFocus() override {}
   void ForceCommit() override;
   bool HasCommit() override;
   Region DamagedRegion() override;
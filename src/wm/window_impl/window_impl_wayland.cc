@@ -65,6 +65,16 @@ void WindowImplWayland::TakeFocus() {
   shell_surface_->Activate();
 }
 
+void WindowImplWayland::LoseFocus() {
+  // Nothing is told to a client whose shell surface is gone.
+  if (!shell_surface_)
+    return;
+
+  // Clients drawing their focus state are told they lost it.
+  auto geometry = shell_surface_->window()->geometry();
+  shell_surface_->Configure(geometry.width(), geometry.height());
+}
+
 void WindowImplWayland::ForceCommit() {
   assert(surface_);
   surface_->force_commit();
@@ -80,6 +90,22 @@ Region WindowImplWayland::DamagedRegion() {
   return surface_->damaged_regoin();
 }
 
+Region WindowImplWayland::OpaqueRegion() {
+  assert(surface_);
+  Buffer* buffer = surface_->committed_buffer();
+  if (!buffer)
+    return Region::Empty();
+
+  Region result = Region::Empty();
+  for (auto& rect : surface_->opaque_region().rectangles())
+    result.Union(rect * surface_->buffer_scale());
+  auto viewport = surface_->viewport();
+  viewport.Resolve(buffer->width(), buffer->height());
+  result.Intersect(
+      base::geometry::Rect(0, 0, viewport.width(), viewport.height()));
+  return result;
+}
+
 compositor::DrawQuad WindowImplWayland::GetQuad() {
   assert(surface_);
   if (!surface_->committed_buffer() || !surface_->committed_buffer()->data())
@@ -88,6 +114,11 @@ compositor::DrawQuad WindowImplWayland::GetQuad() {
   return compositor::DrawQuad(surface_->committed_buffer());
 }
 
+compositor::BufferViewport WindowImplWayland::GetViewport() {
+  assert(surface_);
+  return surface_->viewport();
+}
+
 void WindowImplWayland::ClearCommit() {
   assert(surface_);
   surface_->clear_commit();
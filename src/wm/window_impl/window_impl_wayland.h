@@ -27,10 +27,13 @@ class WindowImplWayland : public WindowImpl {
   bool CanResize() override;
   void Configure(int32_t width, int32_t height) override;
   void TakeFocus() override;
+  void LoseFocus() override;
   void ForceCommit() override;
   bool HasCommit() override;
   Region DamagedRegion() override;
+  Region OpaqueRegion() override;
   compositor::DrawQuad GetQuad() override;
+  compositor::BufferViewport GetViewport() override;
   void ClearCommit() override;
   void ClearDamage() override;
   int32_t GetScale() override;
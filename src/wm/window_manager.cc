@@ -87,6 +87,7 @@ void WindowManager::Manage(Window* window) {
 }
 
 void WindowManager::RemoveWindow(Window* window) {
+  layout_transaction_.RemoveWindow(window);
   if (window == mouse_pointer_) {
     set_mouse_pointer(nullptr);
     return;
@@ -7,6 +7,7 @@
 #include "base/geometry.h"
 #include "base/macros.h"
 #include "event/event_hub.h"
+#include "wm/layout_transaction.h"
 #include "wm/mouse_event.h"
 #include "wm/window.h"
 
@@ -176,6 +177,8 @@ class WindowManager : public event::EventObserver, public WMPrimitives {
 
   void DumpWindowHierarchy();
 
+  LayoutTransaction* layout_transaction() { return &layout_transaction_; }
+
  private:
   static WindowManager* g_window_manager;
   std::vector<Window*> windows_;
@@ -199,6 +202,7 @@ class WindowManager : public event::EventObserver, public WMPrimitives {
   Window* input_panel_overlay_ = nullptr;
   std::vector<WindowPolicyAction> policy_actions_;
   std::vector<WindowPolicyAction> policy_actions_once_;
+  LayoutTransaction layout_transaction_;
 };
 
 }  // namespace wm